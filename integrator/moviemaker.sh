@@ -6,9 +6,8 @@
 #                                            #
 # ------------------------------------------ #
 
-MATLAB_CMD="matlab -nosplash"
+FFMPEG_CMD="ffmpeg -y -loglevel error"
 INTEGRATOR_CMD="integrator.out"
-PATH_TO_SCRIPT=/home/miles/MATLAB/Summer_2012/
 PATH_TO_INTEGRATOR=/home/miles/Summer_2012/Summer_Internship/integrator/
 PATH_TO_OUTPUT=${PATH_TO_INTEGRATOR}output/
 PATH_TO_MOVIES=${PATH_TO_INTEGRATOR}movies/
@@ -54,30 +53,37 @@ else
 
         mkdir -p ${PATH_TO_MOVIES}
 
-        # --- Run integrator script with specified parameters
+        # --- Run integrator script with specified parameters. The frames
+        # are rendered by the integrator itself into one PPM stream per
+        # coloring (in the output path of the config file).
+
+        COLORS=tension
+        if [[ $T -eq "0" ]]
+        then
+          COLORS="tension nonaffine"
+        fi
 
         ${PATH_TO_INTEGRATOR}${INTEGRATOR_CMD} -p $P -e $E -r $R -z $Z \
-        --prng $S -t $T
+        --prng $S -t $T --render-fn movie --render-stream 1 \
+        --render-width 1024 --render-color ${COLORS}
 
         cd ${PATH_TO_OUTPUT}
 
-        # --- Generate images with matlab and make into movie
-        # Plot raw network motion
+        # --- Encode the frames
+        # Plot raw network motion, colored by bond tension
 
-        ${MATLAB_CMD} < ${PATH_TO_SCRIPT}plotNodes.m
-        mencoder mf://@movie.txt -ovc x264 -vf scale=1024:768 -mf type=tiff -o \
-        ${PATH_TO_MOVIES}network_movie_z${Z/./_}p${P/./_}e${E/./_}r${R/./_}t${T/./_}.avi
+        ${FFMPEG_CMD} -f image2pipe -c:v ppm -i movie_tension.ppm -c:v libx264 \
+          -pix_fmt yuv420p \
+          ${PATH_TO_MOVIES}network_movie_z${Z/./_}p${P/./_}e${E/./_}r${R/./_}t${T/./_}.avi
 
         if [[ $T -eq "0" ]]
         then
-          ${MATLAB_CMD} < ${PATH_TO_SCRIPT}plotNonAffine.m
-          mencoder mf://@movie.txt -ovc x264 -vf scale=1024:768 -mf type=tiff \
-            -o ${PATH_TO_MOVIES}nonaff_motion_z${Z/./_}p${P/./_}e${E/./_}r${R/./_}t${T/./_}.avi
-
-          ${MATLAB_CMD} < ${PATH_TO_SCRIPT}affine_and_nonaff.m
-          mencoder mf://@movie.txt -ovc x264 -vf scale=1024:768 -mf type=tiff \
-            -o ${PATH_TO_MOVIES}nonaff_vs_affine_z${Z/./_}p${P/./_}e${E/./_}r${R/./_}t${T/./_}.avi
+          ${FFMPEG_CMD} -f image2pipe -c:v ppm -i movie_nonaffine.ppm -c:v libx264 \
+            -pix_fmt yuv420p \
+            ${PATH_TO_MOVIES}nonaff_motion_z${Z/./_}p${P/./_}e${E/./_}r${R/./_}t${T/./_}.avi
         fi
+
+        rm -f movie_tension.ppm movie_nonaffine.ppm
         cd ${CWD}
 
     fi
@@ -0,0 +1,304 @@
+#!/bin/bash
+
+# ------------------------------------------ #
+#                                            #
+#                regress.sh                  #
+#                                            #
+# ------------------------------------------ #
+#
+# Runs a fixed set of seeded integrator and static minimizer workloads. The
+# output of every workload is compared number by number with the golden files
+# in golden/, and its CPU time (best of REPEATS runs) with baseline.txt. The
+# script fails if any number differs by more than the tolerance or if any
+# workload is more than THRESHOLD slower than its baseline.
+#
+# Usage: regress.sh [--update]
+#
+# --update replaces the golden files and the baseline with the results of
+# this run. Only do this after checking that a change of results is
+# intended; the baseline is specific to the machine it was recorded on.
+#
+# It also checks analyze.out on synthetic pure sines, whose rate and moduli
+# are known and which have no harmonics.
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+INTEGRATOR=${HERE}/../integrator.out
+ANALYZE=${HERE}/../analyze.out
+MINIMIZER=${HERE}/../../testMiles/source/program
+GOLDEN=${HERE}/golden
+BASELINE=${HERE}/baseline.txt
+
+RELTOL=${RELTOL:-1e-4}        # Relative tolerance for numbers
+ABSTOL=${ABSTOL:-1e-8}        # Absolute tolerance for numbers
+THRESHOLD=${THRESHOLD:-0.25}  # Allowed fractional slowdown
+REPEATS=${REPEATS:-3}         # Runs per workload, the fastest is kept
+
+UPDATE=0
+if [[ "$1" == "--update" ]]
+then
+    UPDATE=1
+fi
+
+# --- Workloads: name and integrator arguments. Every workload writes its
+# stress and nonaffinity files.
+
+INTEGRATOR_WORKLOADS=(
+    "elastic|-z 48 -p 0.8 -e 0.01 -r 1.0 --prng 5"
+    "dilute|-z 48 -p 0.65 -e 0.05 -r 0.1 --prng 11"
+    "thermal|-z 32 -p 0.8 -e 0.01 -r 1.0 -t 0.01 --prng 7"
+    "motors|-z 40 -p 0.8 -e 0.01 -r 1.0 -m 1 --prng 3"
+    "largestrain|-z 40 -p 0.8 -e 5.0 -r 0.1 --prng 5"
+    "procs|-z 48 -p 0.8 -e 0.01 -r 1.0 -n 2 --prng 5"
+    "rollback|-z 24 -p 0.8 -e 0.5 -r 1.0 -n 4 --prng 7 --max-step 1e-5 --health-steps 5 --health-depth 8"
+)
+
+# The rollback workload forces the health monitor to split steps into
+# substeps on four processes; its golden files are those of one process.
+
+# Static minimizer workloads: name and program arguments.
+
+MINIMIZER_WORKLOADS=(
+    "minimizer|-size 20 -str 0.02 -p 0.8 -seed 3"
+)
+
+WORK=$(mktemp -d)
+trap 'rm -rf "${WORK}"' EXIT
+
+FAILED=0
+
+# numdiff compares two text files field by field. Fields are separated by
+# commas, spaces and equals signs; numbers must agree within the tolerances
+# and everything else must be identical.
+
+numdiff()
+{
+    awk -v reltol="${RELTOL}" -v abstol="${ABSTOL}" -v golden="$1" '
+        function abs(x) { return x < 0 ? -x : x }
+        function isnum(x) { return x ~ /^[-+]?([0-9]+\.?[0-9]*|\.[0-9]+)([eE][-+]?[0-9]+)?$/ }
+        {
+            if ((getline line < golden) <= 0) {
+                printf "  line %d: extra line in output\n", NR
+                failed = 1
+                exit 1
+            }
+            n = split($0, out, /[, =]+/)
+            m = split(line, ref, /[, =]+/)
+            if (n != m) {
+                printf "  line %d: %d fields, golden has %d\n", NR, n, m
+                failed = 1
+                exit 1
+            }
+            for (f = 1; f <= n; f++) {
+                if (isnum(out[f]) && isnum(ref[f])) {
+                    diff = abs(out[f] - ref[f])
+                    if (diff > abstol && diff > reltol * abs(ref[f])) {
+                        printf "  line %d, field %d: %s, golden %s\n", NR, f, out[f], ref[f]
+                        failed = 1
+                        exit 1
+                    }
+                } else if (out[f] != ref[f]) {
+                    printf "  line %d, field %d: \"%s\", golden \"%s\"\n", NR, f, out[f], ref[f]
+                    failed = 1
+                    exit 1
+                }
+            }
+        }
+        END {
+            if (failed)
+                exit 1
+            if ((getline line < golden) > 0) {
+                printf "  output ends early at line %d\n", NR + 1
+                exit 1
+            }
+        }' "$2"
+}
+
+# check compares the listed output files of a workload with its golden files
+# (or replaces the golden files with --update).
+
+check()
+{
+    local name=$1 dir=$2
+    shift 2
+
+    for file in "$@"
+    do
+        if [[ ${UPDATE} -eq 1 ]]
+        then
+            mkdir -p "${GOLDEN}/${name}"
+            cp "${dir}/${file}" "${GOLDEN}/${name}/${file}"
+        elif [[ ! -f "${GOLDEN}/${name}/${file}" ]]
+        then
+            echo "FAIL ${name}: no golden file ${file}"
+            FAILED=1
+        elif ! numdiff "${GOLDEN}/${name}/${file}" "${dir}/${file}"
+        then
+            echo "FAIL ${name}: ${file} differs from the golden file"
+            FAILED=1
+        fi
+    done
+}
+
+# timing records the run time of a workload (or compares it with the
+# baseline).
+
+TIMINGS=${WORK}/timings.txt
+
+timing()
+{
+    local name=$1 seconds=$2
+
+    echo "${name} ${seconds}" >> "${TIMINGS}"
+
+    if [[ ${UPDATE} -eq 1 ]]
+    then
+        printf "%-12s %8.3f s\n" "${name}" "${seconds}"
+        return
+    fi
+
+    local base=$(awk -v n="${name}" '$1 == n { print $2 }' "${BASELINE}" 2> /dev/null)
+
+    if [[ -z ${base} ]]
+    then
+        printf "%-12s %8.3f s (no baseline)\n" "${name}" "${seconds}"
+        return
+    fi
+
+    local slow=$(awk -v s="${seconds}" -v b="${base}" -v t="${THRESHOLD}" \
+        'BEGIN { print (s > b * (1 + t)) ? 1 : 0 }')
+
+    printf "%-12s %8.3f s (baseline %8.3f s)\n" "${name}" "${seconds}" "${base}"
+
+    if [[ ${slow} -eq 1 ]]
+    then
+        echo "FAIL ${name}: more than ${THRESHOLD} slower than the baseline"
+        FAILED=1
+    fi
+}
+
+# run executes a command REPEATS times in a fresh directory and prints the
+# smallest CPU time (user and system, including child processes) it took.
+# CPU time is used rather than wall time because it is much less sensitive
+# to other jobs on the machine. The output of the last run is kept in the
+# directory.
+
+run()
+{
+    local dir=$1
+    shift
+    local best= cpu
+
+    for ((r = 0; r < REPEATS; r++))
+    do
+        rm -rf "${dir}"
+        mkdir -p "${dir}"
+
+        cpu=$( { TIMEFORMAT='%3U %3S'; time (cd "${dir}" && "$@" > "${dir}/log" 2>&1); } 2>&1 ) \
+            || return 1
+
+        best=$(echo ${cpu} | awk -v b="${best}" \
+            '{ t = $1 + $2; print (b == "" || t < b) ? t : b }')
+    done
+
+    echo "${best}"
+}
+
+if [[ ! -x ${INTEGRATOR} || ! -x ${ANALYZE} || ! -x ${MINIMIZER} ]]
+then
+    echo "Build integrator.out, analyze.out and testMiles/source/program first."
+    exit 1
+fi
+
+for workload in "${INTEGRATOR_WORKLOADS[@]}"
+do
+    name=${workload%%|*}
+    args=${workload#*|}
+    dir=${WORK}/${name}
+
+    conf=${WORK}/${name}.conf
+    printf "output = %s\nst-fn = stress\naff-fn = nonaff\nnum-osc = 2\nout-per-osc = 20\n" \
+        "${dir}" > "${conf}"
+
+    if ! seconds=$(run "${dir}" "${INTEGRATOR}" -c "${conf}" ${args})
+    then
+        echo "FAIL ${name}: integrator.out exited with an error"
+        FAILED=1
+        continue
+    fi
+
+    check "${name}" "${dir}" stress.txt nonaff.txt
+    timing "${name}" "${seconds}"
+done
+
+for workload in "${MINIMIZER_WORKLOADS[@]}"
+do
+    name=${workload%%|*}
+    args=${workload#*|}
+    dir=${WORK}/${name}
+
+    if ! seconds=$(run "${dir}" "${MINIMIZER}" ${args})
+    then
+        echo "FAIL ${name}: program exited with an error"
+        FAILED=1
+        continue
+    fi
+
+    check "${name}" "${dir}" compare_data.txt energy_data.txt position_data.txt
+    timing "${name}" "${seconds}"
+done
+
+# Synthetic pure sines: strain 0.01 sin(t) and stress 0.3 sin(t + 0.2), so
+# the rate is 1, G' = 30 cos(0.2), G'' = 30 sin(0.2) and I3/I1 = THD = 0.
+# Rate detection must find the rate both when the file holds whole cycles
+# (50 samples each, like the stress files) and when it doesn't; the moduli
+# and harmonics are only exact in the first case, since otherwise the cycles
+# analyzed don't span a whole number of samples.
+
+for sine in "3|50" "10|50" "3|37.3" "4.6|41.9"
+do
+    cycles=${sine%%|*}
+    perCycle=${sine#*|}
+    file=${WORK}/sine-${cycles}-${perCycle}.txt
+    whole=0
+    [[ ${perCycle} == 50 ]] && whole=1
+
+    awk -v c="${cycles}" -v p="${perCycle}" 'BEGIN {
+        pi = atan2(0, -1)
+        for (k = 0; k < int(c * p); k++) {
+            t = 2 * pi * k / p
+            printf "%.17g,%.17g,%.17g\n", 0.3 * sin(t + 0.2), 0.01 * sin(t), t
+        }
+    }' > "${file}"
+
+    if ! "${ANALYZE}" "${file}" | awk -F, -v whole=${whole} '
+        function abs(x) { return x < 0 ? -x : x }
+        NR == 2 {
+            ok = abs($3 - 1) < 1e-5
+            if (whole)
+                ok = ok && abs($5 - 30 * cos(0.2)) < 1e-4 && abs($6 - 30 * sin(0.2)) < 1e-4 \
+                    && $8 < 1e-6 && $9 < 1e-6
+            if (!ok)
+                print "  " $0
+            exit !ok
+        }'
+    then
+        echo "FAIL analyze: pure sine of ${cycles} cycles of ${perCycle} samples"
+        FAILED=1
+    fi
+done
+
+if [[ ${UPDATE} -eq 1 ]]
+then
+    cp "${TIMINGS}" "${BASELINE}"
+    echo "Golden files and baseline updated."
+    exit 0
+fi
+
+if [[ ${FAILED} -ne 0 ]]
+then
+    echo "Regression check FAILED."
+    exit 1
+fi
+
+echo "Regression check passed."
+exit 0
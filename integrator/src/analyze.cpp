@@ -0,0 +1,506 @@
+/* analyze.cpp
+ * -----------
+ *
+ * analyze.cpp computes the linear viscoelastic response from the stress
+ * files written by the integrator (lines of stress,strain,time, see
+ * Printer::printStress). For every file, the stress and the strain are
+ * filtered at the drive frequency w and its harmonics with the Goertzel
+ * algorithm, which gives
+ *
+ *   G'  = Re(stress(w) / strain(w)), the storage modulus,
+ *   G'' = Im(stress(w) / strain(w)), the loss modulus,
+ *   tan delta = G'' / G',
+ *   I3/I1 = |stress(3w)| / |stress(w)|, the third harmonic ratio, and
+ *   THD, the root sum square of the harmonics 2w to 9w relative to w.
+ *
+ * Only whole cycles of the drive are used, and the first cycle is skipped
+ * (if there are at least two) since it contains the start-up transient.
+ * Unless --rate is given, the drive frequency is that of the sine fitted
+ * best to the strain, which is exact for a pure sine even over a few cycles.
+ *
+ * The files are memory-mapped and analyzed by a pool of threads, and one
+ * table with a line per file is written to standard output, in the order
+ * in which the files were given.
+ *
+ * Usage: analyze.out [options] files...
+ *
+ * With --list, the names of the files are read from a file ("-" for
+ * standard input), one per line, e.g. from find for a whole sweep.
+ *
+ * With --nonaff name, the nonaffinity file of that name in the directory of
+ * each stress file (e.g. nonaff.txt, see --aff-fn of the integrator) is read
+ * as well, and the means of both nonaffinity measures over the cycles
+ * analyzed are added to the table, as nonaffinity and nonaffinity_dd.
+ */
+
+#include <string>
+#include <vector>
+#include <complex>
+#include <thread>
+#include <atomic>
+#include <charconv>
+#include <cstdio>
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <boost/program_options.hpp>
+
+namespace po = boost::program_options;
+
+const double PI = 3.1415926535897932;
+
+enum {num_harmonics = 9};
+
+struct Result {
+
+    bool ok;
+    std::string error;
+    int samples;
+    double rate;            // Drive frequency used
+    double cycles;          // Number of cycles analyzed
+    double storage, loss;   // G' and G''
+    double i3;              // I3/I1
+    double thd;             // Total harmonic distortion
+    double nonaff;          // Mean nonaffinity over the cycles analyzed
+    double nonaffdd;        // ... and that of the derivatives
+
+    Result() : ok(false), samples(0), rate(0), cycles(0), storage(0), loss(0),
+        i3(0), thd(0), nonaff(0), nonaffdd(0) {}
+
+};
+
+struct Series {
+
+    std::vector<double> stress, strain, time;
+
+};
+
+// readSeries maps the file into memory and parses its lines. It returns an
+// empty string, or a description of what went wrong.
+
+static std::string readSeries(const std::string &fileName, Series &series)
+{
+    int fd = open(fileName.c_str(), O_RDONLY);
+
+    if (fd < 0)
+        return "cannot open";
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return "empty";
+    }
+
+    size_t size = st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED)
+        return "cannot map";
+
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    const char *p = (const char *) map, *end = p + size;
+    std::string error;
+
+    while (p < end)
+    {
+        double values[3];
+
+        for (int v = 0; v < 3; v++)
+        {
+            std::from_chars_result r = std::from_chars(p, end, values[v]);
+
+            if (r.ec != std::errc())
+            {
+                error = "bad number";
+                break;
+            }
+
+            p = r.ptr;
+
+            if (v < 2)
+            {
+                if (p >= end || *p != ',')
+                {
+                    error = "expected stress,strain,time";
+                    break;
+                }
+                p++;
+            }
+        }
+
+        if (!error.empty())
+            break;
+
+        series.stress.push_back(values[0]);
+        series.strain.push_back(values[1]);
+        series.time.push_back(values[2]);
+
+        while (p < end && (*p == '\n' || *p == '\r'))
+            p++;
+    }
+
+    munmap(map, size);
+    return error;
+}
+
+// goertzel returns sum x[n] exp(-i w n) over the n samples of x, for any
+// frequency w in radians per sample.
+
+static std::complex<double> goertzel(const double *x, int n, double w)
+{
+    double coeff = 2.0 * cos(w);
+    double s1 = 0.0, s2 = 0.0;
+
+    for (int k = 0; k < n; k++)
+    {
+        double s0 = x[k] + coeff * s1 - s2;
+        s2 = s1;
+        s1 = s0;
+    }
+
+    std::complex<double> y = s1 - std::polar(1.0, -w) * s2;
+    return y * std::polar(1.0, -w * (n - 1));
+}
+
+// fitEnergy returns the part of the energy of x explained by the least
+// squares fit of a cos(w n) + b sin(w n) + c. Unlike the power of the
+// Fourier component at w, it has no bias from the image at -w or from the
+// mean, so for a pure sine it peaks exactly at its frequency, whether or not
+// x holds whole cycles.
+
+static double fitEnergy(const double *x, int n, double w)
+{
+    double A[3][3] = {{0}}, y[3] = {0};
+
+    for (int k = 0; k < n; k++)
+    {
+        double f[3] = {cos(w * k), sin(w * k), 1.0};
+
+        for (int i = 0; i < 3; i++)
+        {
+            y[i] += f[i] * x[k];
+            for (int j = 0; j < 3; j++)
+                A[i][j] += f[i] * f[j];
+        }
+    }
+
+    // Solve A c = y by Gaussian elimination; the energy is c . y.
+
+    for (int i = 0; i < 3; i++)
+    {
+        for (int r = i + 1; r < 3; r++)
+        {
+            double m = A[r][i] / A[i][i];
+            for (int j = i; j < 3; j++)
+                A[r][j] -= m * A[i][j];
+            y[r] -= m * y[i];
+        }
+    }
+
+    double c[3], energy = 0.0;
+
+    for (int i = 2; i >= 0; i--)
+    {
+        c[i] = y[i];
+        for (int j = i + 1; j < 3; j++)
+            c[i] -= A[i][j] * c[j];
+        c[i] /= A[i][i];
+    }
+
+    for (int k = 0; k < n; k++)
+    {
+        double fit = c[0] * cos(w * k) + c[1] * sin(w * k) + c[2];
+        energy += fit * x[k];
+    }
+
+    return energy;
+}
+
+// detectRate finds the drive frequency from the strain. The largest Fourier
+// component with a whole number of cycles in the file brackets it, and the
+// sine fitted best to the strain (see fitEnergy) within a cycle of that
+// gives it, by a golden section search.
+
+static double detectRate(const Series &series, double dt)
+{
+    const double *x = &series.strain[0];
+    int n = series.strain.size();
+    double best = 0.0;
+    int bestCycles = 1;
+
+    for (int c = 1; c <= n / 2; c++)
+    {
+        double a = std::abs(goertzel(x, n, 2 * PI * c / n));
+
+        if (a > best)
+        {
+            best = a;
+            bestCycles = c;
+        }
+    }
+
+    const double golden = 0.5 * (sqrt(5.0) - 1.0);
+    double lo = 2 * PI * (bestCycles - 0.5) / n, hi = 2 * PI * (bestCycles + 0.5) / n;
+    double a = hi - golden * (hi - lo), b = lo + golden * (hi - lo);
+    double fa = fitEnergy(x, n, a), fb = fitEnergy(x, n, b);
+
+    for (int k = 0; k < 80 && hi - lo > 1e-13; k++)
+    {
+        if (fa > fb)
+        {
+            hi = b; b = a; fb = fa;
+            a = hi - golden * (hi - lo);
+            fa = fitEnergy(x, n, a);
+        }
+        else
+        {
+            lo = a; a = b; fa = fb;
+            b = lo + golden * (hi - lo);
+            fb = fitEnergy(x, n, b);
+        }
+    }
+
+    return 0.5 * (lo + hi) / dt;
+}
+
+// readNonaff averages the nonaffinity file of the run (lines of
+// time,strain,nonaffinity,rate,nonaffinity_dd after a header line, see
+// Printer::printNonAff) over the samples between the times from and to. It
+// returns an empty string, or a description of what went wrong.
+
+static std::string readNonaff(const std::string &fileName, double from, double to,
+        Result &result)
+{
+    std::ifstream file(fileName.c_str());
+    std::string line;
+    int samples = 0;
+
+    if (!file || !std::getline(file, line))
+        return "cannot read " + fileName;
+
+    while (std::getline(file, line))
+    {
+        double time, strain, nonaff, rate, nonaffdd;
+
+        if (sscanf(line.c_str(), "%lf,%lf,%lf,%lf,%lf", &time, &strain, &nonaff,
+                    &rate, &nonaffdd) != 5)
+            return "bad line in " + fileName;
+
+        if (time >= from && time <= to)
+        {
+            result.nonaff += nonaff;
+            result.nonaffdd += nonaffdd;
+            samples++;
+        }
+    }
+
+    if (samples == 0)
+        return "no nonaffinity in the cycles analyzed";
+
+    result.nonaff /= samples;
+    result.nonaffdd /= samples;
+
+    return "";
+}
+
+static Result analyze(const std::string &fileName, double rate, const std::string &nonaffName)
+{
+    Result result;
+    Series series;
+
+    result.error = readSeries(fileName, series);
+
+    if (!result.error.empty())
+        return result;
+
+    int n = series.stress.size();
+    result.samples = n;
+
+    if (n < 4)
+    {
+        result.error = "too few samples";
+        return result;
+    }
+
+    double dt = series.time[1] - series.time[0];
+
+    if (!(dt > 0.0))
+    {
+        result.error = "time does not increase";
+        return result;
+    }
+
+    result.rate = rate > 0.0 ? rate : detectRate(series, dt);
+
+    // Samples per cycle, and the whole cycles in the file.
+
+    double period = 2 * PI / (result.rate * dt);
+    int cycles = (int) floor(n / period + 1e-6);
+    int skip = cycles >= 2 ? (int) floor(period + 0.5) : 0;
+
+    if (cycles < 1)
+    {
+        result.error = "less than one cycle";
+        return result;
+    }
+
+    if (cycles >= 2)
+        cycles--;
+
+    int used = (int) floor(cycles * period + 0.5);
+
+    if (skip + used > n)
+        used = n - skip;
+
+    double w = result.rate * dt;
+    std::complex<double> stress[num_harmonics + 1];
+
+    for (int h = 1; h <= num_harmonics; h++)
+        stress[h] = goertzel(&series.stress[skip], used, h * w);
+
+    std::complex<double> strain = goertzel(&series.strain[skip], used, w);
+    std::complex<double> modulus = stress[1] / strain;
+
+    double harmonics = 0.0;
+    for (int h = 2; h <= num_harmonics; h++)
+        harmonics += std::norm(stress[h]);
+
+    result.cycles = cycles;
+    result.storage = modulus.real();
+    result.loss = modulus.imag();
+    result.i3 = std::abs(stress[3]) / std::abs(stress[1]);
+    result.thd = sqrt(harmonics) / std::abs(stress[1]);
+
+    // The nonaffinity file is in the directory of the stress file. Its times
+    // are rounded, so the window is widened by half a sample.
+
+    if (!nonaffName.empty())
+    {
+        std::string dir = fileName.substr(0, fileName.rfind('/') + 1);
+
+        result.error = readNonaff(dir + nonaffName, series.time[skip] - 0.5 * dt,
+                series.time[skip + used - 1] + 0.5 * dt, result);
+
+        if (!result.error.empty())
+            return result;
+    }
+
+    result.ok = true;
+
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> files;
+    std::string list, nonaffName;
+    double rate;
+    int threads;
+
+    po::options_description options("Analysis options");
+    options.add_options()
+        ("help,h", "show this help text")
+        ("rate,r", po::value<double>(&rate)->default_value(0.0),
+             "drive frequency (0: find it from the strain)")
+        ("list,l", po::value<std::string>(&list),
+             "read the names of the files from this file (-: standard input)")
+        ("nonaff,a", po::value<std::string>(&nonaffName),
+             "also average the nonaffinity file of this name next to each stress file")
+        ("threads,j", po::value<int>(&threads)->default_value(0),
+             "number of threads (0: one per processor)")
+        ("files", po::value<std::vector<std::string> >(&files), "stress files")
+        ;
+
+    po::positional_options_description positional;
+    positional.add("files", -1);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(options)
+            .positional(positional).run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help"))
+    {
+        std::cout << "Usage: analyze.out [options] files...\n" << options << std::endl;
+        return 1;
+    }
+
+    if (!list.empty())
+    {
+        std::ifstream listFile;
+        std::istream &in = list == "-" ? std::cin : (listFile.open(list.c_str()), listFile);
+        std::string line;
+
+        if (!in)
+        {
+            std::cout << "Couldn't open " << list << ".\n";
+            return 1;
+        }
+
+        while (std::getline(in, line))
+            if (!line.empty())
+                files.push_back(line);
+    }
+
+    if (files.empty())
+    {
+        std::cout << "No stress files given.\n";
+        return 1;
+    }
+
+    if (threads <= 0)
+        threads = std::max(1, (int) std::thread::hardware_concurrency());
+
+    // Every thread takes the next file that nobody has analyzed yet.
+
+    std::vector<Result> results(files.size());
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> pool;
+
+    for (int t = 0; t < threads; t++)
+    {
+        pool.push_back(std::thread([&]() {
+            for (size_t f = next++; f < files.size(); f = next++)
+                results[f] = analyze(files[f], rate, nonaffName);
+        }));
+    }
+
+    for (size_t t = 0; t < pool.size(); t++)
+        pool[t].join();
+
+    int failed = 0;
+
+    printf("file,samples,rate,cycles,G',G'',tan_delta,I3/I1,THD%s\n",
+            nonaffName.empty() ? "" : ",nonaffinity,nonaffinity_dd");
+
+    for (size_t f = 0; f < files.size(); f++)
+    {
+        const Result &r = results[f];
+
+        if (!r.ok)
+        {
+            fprintf(stderr, "%s: %s\n", files[f].c_str(), r.error.c_str());
+            failed++;
+            continue;
+        }
+
+        printf("%s,%d,%.6g,%.0f,%.6g,%.6g,%.6g,%.6g,%.6g", files[f].c_str(),
+                r.samples, r.rate, r.cycles, r.storage, r.loss, r.loss / r.storage,
+                r.i3, r.thd);
+
+        if (!nonaffName.empty())
+            printf(",%.6g,%.6g", r.nonaff, r.nonaffdd);
+
+        printf("\n");
+    }
+
+    return failed ? 2 : 0;
+}
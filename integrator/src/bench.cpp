@@ -0,0 +1,295 @@
+/* bench.cpp
+ * ---------
+ *
+ * bench.cpp times the hot kernels of the integrator: the force calculation
+ * (with and without motors), the stress calculation, the node mover, the
+ * motor update and the two nonaffinity measures. Every combination of the
+ * requested network sizes, bond probabilities, temperatures and motor
+ * settings is timed, and one line per kernel is printed with the time per
+ * node per call and the memory traffic implied by the arrays the kernel
+ * touches.
+ *
+ * Usage: bench.out [-z sizes...] [-p probabilities...] [-t temperatures...]
+ *                  [-m motors...] [--min-time seconds]
+ */
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <ctime>
+#include <iostream>
+#include <boost/program_options.hpp>
+
+namespace po = boost::program_options;
+
+#include "utils.h"
+#include "network.h"
+#include "motors.h"
+#include "nonaffinity.h"
+
+const double RESTLEN = 1.0;
+const double ETA = 1.0e0;
+const double RADIUS = 1.0;
+const double YOUNGMOD = 1.0;
+double TIMESTEP = 2 * PI / 1000;
+double affdel = 0.0;
+
+int netSize;
+double strain;
+int frame_sep;
+
+// The kernels that are timed, and the number of bytes each has to move per
+// node, counting every array it reads or writes once. Pointer tables of the
+// double*** arrays are counted as one pointer per node.
+
+enum Kernel {
+    forces_kernel, stress_kernel, move_kernel, motors_kernel, nonaff_kernel,
+    nonaffdd_kernel, num_kernels
+};
+
+static const char *kernelNames[num_kernels] = {
+    "getNetForces", "calcStress", "moveNodes", "step_motors", "nonAffinity",
+    "nonAffinity_dd"
+};
+
+static const double kernelBytes[num_kernels] = {
+    16 + 15 + 32 + 56,      // pos, neighbor tables, springs, forces
+    16 + 15 + 56,           // pos, neighbor tables, forces
+    56 + 32 + 16,           // forces, pos (read and write), delta
+    24 * 2 + 32,            // motortimes (read and write), springs
+    16,                     // pos
+    16                      // delta
+};
+
+// Extra bytes per node for the motor variant of getNetForces.
+static const double motorForceBytes = 24 * 2 + 24;
+
+static double now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+struct Bench {
+
+    Network &net;
+    Motors &motors;
+    int useMotors;
+    double temp;
+    double rate;
+
+    Bench(Network &nnet, Motors &mmotors, int uuseMotors, double ttemp) :
+        net(nnet),
+        motors(mmotors),
+        useMotors(uuseMotors),
+        temp(ttemp),
+        rate(1.0) {}
+
+    // run calls the kernel once. Checksums are accumulated so that the
+    // compiler cannot discard the calls.
+    double run(int kernel) {
+
+        switch (kernel) {
+
+            case forces_kernel:
+                if (useMotors)
+                    net.getNetForces(motors);
+                else
+                    net.getNetForces();
+                return net.forces[0][0][0];
+
+            case stress_kernel:
+                return net.calcStress(rate);
+
+            case move_kernel:
+                // Reverse the shear whenever the top of the network has moved
+                // by a lattice spacing, so the strain stays small however
+                // often the kernel is called.
+                if (std::abs(affdel) > RESTLEN)
+                    rate = affdel > 0 ? -1.0 : 1.0;
+                net.moveNodes(rate, temp);
+                return net.pos[0];
+
+            case motors_kernel:
+                motors.step_motors();
+                return 0.0;
+
+            case nonaff_kernel:
+                return nonAffinity(net.pos);
+
+            case nonaffdd_kernel:
+                return nonAffinity_dd(net.pos, net.delta, rate);
+        }
+
+        return 0.0;
+    }
+
+    // time runs the kernel repeatedly, doubling the repetitions until they
+    // take at least minTime seconds, and returns the time per call.
+    double time(int kernel, double minTime, double &checksum) {
+
+        int reps = 1;
+
+        while (true) {
+
+            double start = now();
+
+            for (int r = 0; r < reps; r++)
+                checksum += run(kernel);
+
+            double elapsed = now() - start;
+
+            if (elapsed >= minTime || reps >= (1 << 24))
+                return elapsed / reps;
+
+            reps *= 2;
+        }
+    }
+
+};
+
+int main(int argc, char *argv[])
+{
+    std::vector<int> sizes, motorList;
+    std::vector<double> probs, temps;
+    double minTime;
+
+    po::options_description options("Benchmark options");
+    options.add_options()
+        ("help,h", "show this help text")
+        ("netsize,z", po::value<std::vector<int> >(&sizes)->multitoken(),
+             "network sizes (16 64 256 1024 4096)")
+        ("probability,p", po::value<std::vector<double> >(&probs)->multitoken(),
+             "bond probabilities (0.8)")
+        ("temp,t", po::value<std::vector<double> >(&temps)->multitoken(),
+             "temperatures (0 0.01)")
+        ("motors,m", po::value<std::vector<int> >(&motorList)->multitoken(),
+             "motor settings (0 1)")
+        ("min-time", po::value<double>(&minTime)->default_value(0.2),
+             "minimum time spent on each kernel in seconds")
+        ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, options), vm);
+    po::notify(vm);
+
+    if (vm.count("help"))
+    {
+        std::cout << options << std::endl;
+        return 1;
+    }
+
+    if (sizes.empty())
+    {
+        // 4096 is far out of cache, so the kernels run from memory as in
+        // production runs; it takes about 3 GB.
+        int defaults[] = {16, 64, 256, 1024, 4096};
+        sizes.assign(defaults, defaults + 5);
+    }
+    if (probs.empty())
+        probs.push_back(0.8);
+    if (temps.empty())
+    {
+        temps.push_back(0.0);
+        temps.push_back(0.01);
+    }
+    if (motorList.empty())
+    {
+        motorList.push_back(0);
+        motorList.push_back(1);
+    }
+
+    double checksum = 0.0;
+
+    printf("%-15s %7s %6s %6s %6s %14s %12s %10s\n", "kernel", "netSize",
+            "pBond", "temp", "motors", "ns/node-step", "bytes/node", "GB/s");
+
+    for (size_t a = 0; a < sizes.size(); a++)
+    for (size_t b = 0; b < probs.size(); b++)
+    for (size_t c = 0; c < temps.size(); c++)
+    for (size_t d = 0; d < motorList.size(); d++)
+    {
+        netSize = sizes[a];
+        affdel = 0.0;
+        srand(1);
+
+        double *position = new double [2 * netSize * netSize];
+        double *delta = new double [2 * netSize * netSize];
+        double ***sprstiff = new double **[netSize];
+        double ***netForces = new double **[netSize];
+
+        for (int i = 0; i < netSize; i++)
+        {
+            sprstiff[i] = new double *[netSize];
+            netForces[i] = new double *[netSize];
+
+            for (int j = 0; j < netSize; j++)
+            {
+                position[(i * netSize + j) * 2] = RESTLEN * (i / 2.0 + j);
+                position[(i * netSize + j) * 2 + 1] = sqrt(3) / 2 * RESTLEN * i;
+                delta[(i * netSize + j) * 2] = 0.0;
+                delta[(i * netSize + j) * 2 + 1] = 0.0;
+
+                sprstiff[i][j] = stiffVecGen(probs[b], 3);
+                netForces[i][j] = new double[6];
+            }
+        }
+
+        {
+            Network myNetwork(position, delta, sprstiff, netForces);
+            Motors myMotors(sprstiff);
+            Bench bench(myNetwork, myMotors, motorList[d], temps[c]);
+
+            // Shear the network a little first, so that the nonaffinity
+            // measures do not return early.
+
+            for (int s = 0; s < 10; s++)
+            {
+                bench.run(forces_kernel);
+                bench.run(move_kernel);
+            }
+
+            for (int k = 0; k < num_kernels; k++)
+            {
+                if (k == motors_kernel && !motorList[d])
+                    continue;
+
+                double perCall = bench.time(k, minTime, checksum);
+                double nodes = (double) netSize * netSize;
+                double bytes = kernelBytes[k];
+
+                if (k == forces_kernel && motorList[d])
+                    bytes += motorForceBytes;
+
+                printf("%-15s %7d %6.3g %6.3g %6d %14.3f %12.0f %10.3f\n",
+                        kernelNames[k], netSize, probs[b], temps[c],
+                        motorList[d], 1e9 * perCall / nodes, bytes,
+                        bytes * nodes / perCall * 1e-9);
+            }
+        }
+
+        for (int i = 0; i < netSize; i++)
+        {
+            for (int j = 0; j < netSize; j++)
+            {
+                delete[] sprstiff[i][j];
+                delete[] netForces[i][j];
+            }
+            delete[] sprstiff[i];
+            delete[] netForces[i];
+        }
+
+        delete[] sprstiff;
+        delete[] netForces;
+        delete[] position;
+        delete[] delta;
+    }
+
+    // Printing the checksum keeps the kernels from being optimized away.
+    fprintf(stderr, "checksum %g\n", checksum);
+
+    return 0;
+}
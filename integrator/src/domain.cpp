@@ -0,0 +1,189 @@
+// domain.cpp
+// ----------
+//
+// domain.cpp implements the row-strip decomposition declared in domain.h.
+// The worker processes are started with fork(), so no launcher other than
+// the integrator itself is needed; all shared state is mapped anonymously
+// before the fork.
+
+#include <cstdio>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "domain.h"
+#include "reduce.h"
+
+static void *mapShared(size_t bytes)
+{
+    void *mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (mem == MAP_FAILED)
+        throw("Could not map shared memory");
+
+    return mem;
+}
+
+Domain::Domain(int nnprocs) :
+    rank(0),
+    nprocs(nnprocs),
+    iBegin(0),
+    iEnd(netSize),
+    generation(0),
+    nArrays(0),
+    children(NULL)
+{
+    controlSize = sizeof(pthread_barrier_t)
+        + 2 * (nprocs + netSize) * sizeof(double);
+
+    void *mem = mapShared(controlSize);
+    barrier = static_cast<pthread_barrier_t *>(mem);
+    partial = reinterpret_cast<double *>(static_cast<char *>(mem)
+            + sizeof(pthread_barrier_t));
+    rowPartial = partial + 2 * nprocs;
+
+    pthread_barrierattr_t attr;
+    pthread_barrierattr_init(&attr);
+    pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_barrier_init(barrier, &attr, nprocs);
+    pthread_barrierattr_destroy(&attr);
+}
+
+Domain::~Domain()
+{
+    for (int n = 0; n < nArrays; n++)
+        munmap(arrays[n], arraySizes[n]);
+
+    if (rank == 0)
+        pthread_barrier_destroy(barrier);
+
+    munmap(barrier, controlSize);
+    delete[] children;
+}
+
+double *Domain::allocate(size_t n)
+{
+    if (nArrays == max_arrays)
+        throw("Too many shared arrays");
+
+    arraySizes[nArrays] = n * sizeof(double);
+    arrays[nArrays] = static_cast<double *>(mapShared(arraySizes[nArrays]));
+
+    return arrays[nArrays++];
+}
+
+int Domain::launch()
+{
+    if (nprocs > 1)
+    {
+        children = new int[nprocs - 1];
+
+        // Flush stdout so the children don't repeat buffered output.
+        fflush(stdout);
+
+        for (int r = 1; r < nprocs; r++)
+        {
+            pid_t pid = fork();
+
+            if (pid < 0)
+                throw("Could not fork worker process");
+
+            if (pid == 0)
+            {
+                rank = r;
+                break;
+            }
+
+            children[r - 1] = pid;
+        }
+    }
+
+    iBegin = rank * netSize / nprocs;
+    iEnd = (rank + 1) * netSize / nprocs;
+
+    return rank;
+}
+
+void Domain::exchange()
+{
+    if (nprocs > 1)
+        pthread_barrier_wait(barrier);
+}
+
+double Domain::reduce(double value)
+{
+    if (nprocs == 1)
+        return value;
+
+    double *slot = partial + (generation++ & 1) * nprocs;
+    slot[rank] = value;
+
+    pthread_barrier_wait(barrier);
+
+    double sum = 0.0;
+    for (int r = 0; r < nprocs; r++)
+        sum += slot[r];
+
+    return sum;
+}
+
+double Domain::reduceRows(const double *rows)
+{
+    if (nprocs == 1)
+        return sumRows(rows, netSize);
+
+    double *slot = rowPartial + (generation++ & 1) * netSize;
+
+    for (int i = iBegin; i < iEnd; i++)
+        slot[i] = rows[i];
+
+    pthread_barrier_wait(barrier);
+
+    return sumRows(slot, netSize);
+}
+
+double Domain::reduceMax(double value)
+{
+    if (nprocs == 1)
+        return value;
+
+    double *slot = partial + (generation++ & 1) * nprocs;
+    slot[rank] = value;
+
+    pthread_barrier_wait(barrier);
+
+    double worst = 0.0;
+    for (int r = 0; r < nprocs; r++)
+        worst = nanMax(worst, slot[r]);
+
+    return worst;
+}
+
+int Domain::join(int status)
+{
+    if (rank != 0 || children == NULL)
+        return status;
+
+    for (int r = 1; r < nprocs; r++)
+    {
+        int childStatus;
+        waitpid(children[r - 1], &childStatus, 0);
+
+        if (!WIFEXITED(childStatus) || WEXITSTATUS(childStatus) != 0)
+            status = status ? status : 1;
+    }
+
+    return status;
+}
+
+bool Domain::needsRow(int i)
+{
+    if (nprocs == 1)
+        return true;
+
+    int ghost = iBegin == 0 ? netSize - 1 : iBegin - 1;
+
+    return (i >= iBegin && i < iEnd) || i == ghost;
+}
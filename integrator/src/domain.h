@@ -0,0 +1,94 @@
+#ifndef DOMAIN_H_
+#define DOMAIN_H_
+
+// domain.h
+// --------
+//
+// domain.h defines the struct Domain, which splits the network into
+// horizontal strips of rows so that several processes on one machine can
+// integrate a single large network together. Every process owns the rows
+// [iBegin, iEnd) and moves only those nodes.
+//
+// The position and delta arrays live in shared memory, so the halo exchange
+// amounts to a barrier: once every process has moved its own rows, the ghost
+// row below each strip (row iBegin - 1, wrapping around to iMax) is visible
+// to its neighbour. Each process recomputes the forces of its ghost row
+// itself, so the force arrays stay private. Because the strips span the
+// whole width of the network, the only subdomain edge that carries the
+// sheared image (netshift in Network::xshift) is the one between row iMax and
+// row 0, and the force kernels see the global row index there as usual.
+//
+// Strips are used rather than a two-dimensional grid of blocks because the
+// rows of a strip are contiguous in the position array and only one ghost
+// row has to be recomputed per step.
+
+#include <cstddef>
+#include <pthread.h>
+
+extern int netSize;
+
+struct Domain {
+
+    int rank;       // Index of this process (0 is the parent)
+    int nprocs;     // Number of processes sharing the network
+    int iBegin;     // First row owned by this process
+    int iEnd;       // One past the last row owned by this process
+
+    Domain(int nnprocs);
+    ~Domain();
+
+    // allocate returns an array of n doubles in memory that remains shared
+    // with the worker processes. It must be called before launch.
+    double *allocate(size_t n);
+
+    // launch forks the worker processes and assigns each its strip of rows.
+    // It returns the rank of the calling process.
+    int launch();
+
+    // exchange blocks until every process has reached it. Called after the
+    // nodes are moved, this publishes the updated ghost rows.
+    void exchange();
+
+    // reduce returns the sum of value over all processes, added in rank
+    // order so that every process obtains the same result.
+    double reduce(double value);
+
+    // reduceRows returns the sum of rows[0 .. netSize - 1] as sumRows of
+    // reduce.h does, where each process supplies the rows it owns. The
+    // result doesn't depend on the number of processes.
+    double reduceRows(const double *rows);
+
+    // reduceMax returns the largest value of all processes, or NaN if any of
+    // them is NaN.
+    double reduceMax(double value);
+
+    // join waits for the worker processes to finish when called from the
+    // parent. It returns status, or a nonzero value if a worker failed.
+    int join(int status);
+
+    // needsRow is true if row i is owned by this process or is its ghost row.
+    bool needsRow(int i);
+
+    private:
+
+    enum {max_arrays = 8};
+
+    // The barrier and the partial sums used by reduce and reduceRows share
+    // one mapping. partial holds two slots per process and rowPartial two
+    // slots of netSize rows, used alternately so that a process can start
+    // the next reduction while slower ones still read the previous one.
+    pthread_barrier_t *barrier;
+    double *partial;
+    double *rowPartial;
+    size_t controlSize;
+    int generation;
+
+    double *arrays[max_arrays];
+    size_t arraySizes[max_arrays];
+    int nArrays;
+
+    int *children;
+
+};
+
+#endif /* DOMAIN_H_ */
@@ -0,0 +1,126 @@
+/* follow.cpp
+ * ----------
+ *
+ * follow.cpp is integrator-follow, which follows the frame ring of a running
+ * integrator (--frame-ring, see frames.h) and prints a line per frame as it
+ * is published:
+ *
+ *   frame,step,time,strain,stress,rms_delta
+ *
+ * where rms_delta is the root mean square displacement of the nodes in the
+ * last step of the frame. It also serves as an example of a frame ring
+ * reader. Frames that the integrator overwrote before they could be read are
+ * reported on standard error and skipped. It exits when the run has ended
+ * and every frame is read.
+ *
+ * Usage: integrator-follow.out [--from-start] [--interval s] ring
+ */
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cmath>
+#include <ctime>
+#include <iostream>
+#include <boost/program_options.hpp>
+
+#include "frames.h"
+
+namespace po = boost::program_options;
+
+static void pause(double seconds)
+{
+    timespec ts;
+    ts.tv_sec = (time_t) seconds;
+    ts.tv_nsec = (long) ((seconds - ts.tv_sec) * 1e9);
+    nanosleep(&ts, NULL);
+}
+
+int main(int argc, char *argv[])
+{
+    std::string path;
+    double interval;
+
+    po::options_description options("Follow options");
+    options.add_options()
+        ("help,h", "show this help text")
+        ("ring", po::value<std::string>(&path), "frame ring file (--frame-ring of the integrator)")
+        ("interval,i", po::value<double>(&interval)->default_value(0.05),
+             "seconds between polls for new frames")
+        ("from-start", "begin with the oldest frame in the ring, not the newest")
+        ;
+
+    po::positional_options_description positional;
+    positional.add("ring", 1);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(options)
+            .positional(positional).run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help") || path.empty())
+    {
+        std::cout << "Usage: integrator-follow.out [options] ring\n" << options << std::endl;
+        return 1;
+    }
+
+    // Wait for the integrator to create the ring.
+
+    FrameReader reader;
+
+    while (!reader.open(path))
+        pause(interval);
+
+    int slots = reader.header->slots;
+    long long written = reader.written();
+    long long next = vm.count("from-start")
+        ? std::max(written - slots, 0LL) : std::max(written - 1, 0LL);
+    long long lost = 0;
+
+    std::vector<double> delta(2 * reader.nodes());
+    FrameSlot info;
+
+    printf("frame,step,time,strain,stress,rms_delta\n");
+
+    while (true)
+    {
+        // Check whether the run has finished before looking for the frame,
+        // so that the last frame isn't missed.
+
+        bool finished = reader.finished();
+        FrameReader::Result result = reader.read(next, info, NULL, &delta[0]);
+
+        if (result == FrameReader::frame_ok)
+        {
+            double sum = 0.0;
+
+            for (size_t l = 0; l < delta.size(); l++)
+                sum += delta[l] * delta[l];
+
+            printf("%lld,%d,%.6g,%.6g,%.6g,%.6g\n", info.frame, info.step, info.time,
+                    info.strain, info.stress, sqrt(2 * sum / delta.size()));
+            fflush(stdout);
+            next++;
+        }
+        else if (result == FrameReader::frame_lost)
+        {
+            // Skip to the oldest frame still in the ring.
+
+            long long oldest = std::max(reader.written() - slots + 1, next + 1);
+
+            fprintf(stderr, "Lost frames %lld to %lld.\n", next, oldest - 1);
+            lost += oldest - next;
+            next = oldest;
+        }
+        else if (finished)
+            break;
+        else
+            pause(interval);
+    }
+
+    if (lost > 0)
+        fprintf(stderr, "Lost %lld frames in all.\n", lost);
+
+    return 0;
+}
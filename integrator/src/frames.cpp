@@ -0,0 +1,102 @@
+// frames.cpp
+// ----------
+//
+// frames.cpp implements FrameRing, the writer of the frame ring of frames.h.
+
+#include <cstdio>
+
+#include "frames.h"
+
+extern int netSize;
+extern double TIMESTEP;
+
+FrameRing::FrameRing(std::string path, int slots, std::string label,
+        int frameSteps) :
+    header(NULL),
+    size(frameHeaderSize() + slots * frameSlotSize(netSize))
+{
+    if (path.empty())
+        return;
+
+    // A reader still mapping the ring of an earlier run keeps that file, as
+    // the new one replaces it.
+
+    unlink(path.c_str());
+
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0 || ftruncate(fd, size) != 0)
+    {
+        printf("Couldn't create the frame ring %s.\n", path.c_str());
+
+        if (fd >= 0)
+        {
+            close(fd);
+            unlink(path.c_str());
+        }
+
+        return;
+    }
+
+    void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mem == MAP_FAILED)
+    {
+        printf("Couldn't map the frame ring %s.\n", path.c_str());
+        return;
+    }
+
+    // The file is new and zero, so no slot holds a frame yet.
+
+    header = static_cast<FrameRingHeader *>(mem);
+    header->pid = getpid();
+    header->netSize = netSize;
+    header->slots = slots;
+    header->frameSteps = frameSteps;
+    header->slotSize = frameSlotSize(netSize);
+    header->timestep = TIMESTEP;
+    strncpy(header->label, label.c_str(), sizeof(header->label) - 1);
+    header->version = FrameRingHeader::version_value;
+
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = FrameRingHeader::magic_value;
+}
+
+FrameRing::~FrameRing()
+{
+    if (header == NULL)
+        return;
+
+    header->finished.store(1, std::memory_order_release);
+    munmap(header, size);
+}
+
+void FrameRing::publish(int step, double affdel, double strain, double stress,
+        const double *pos, const double *delta)
+{
+    if (header == NULL)
+        return;
+
+    long long f = header->written.load(std::memory_order_relaxed);
+    char *base = reinterpret_cast<char *>(header) + frameHeaderSize()
+        + (f % header->slots) * header->slotSize;
+    FrameSlot *slot = reinterpret_cast<FrameSlot *>(base);
+    double *data = reinterpret_cast<double *>(base + frameDataOffset());
+    size_t bytes = 2 * sizeof(double) * netSize * netSize;
+
+    slot->sequence.store(2 * f + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot->frame = f;
+    slot->step = step;
+    slot->time = step * TIMESTEP;
+    slot->affdel = affdel;
+    slot->strain = strain;
+    slot->stress = stress;
+    memcpy(data, pos, bytes);
+    memcpy(data + 2 * netSize * netSize, delta, bytes);
+
+    slot->sequence.store(2 * f + 2, std::memory_order_release);
+    header->written.store(f + 1, std::memory_order_release);
+}
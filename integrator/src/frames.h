@@ -0,0 +1,209 @@
+#ifndef FRAMES_H_
+#define FRAMES_H_
+
+// frames.h
+// --------
+//
+// frames.h defines the frame ring, a memory-mapped file into which the
+// integrator publishes every output frame (--frame-ring), so that analysis
+// and visualization programs can follow a run while it goes, without the
+// positions being written to disk and parsed again. Put the file in /dev/shm
+// to keep it in memory.
+//
+// The file is a header followed by a ring of slots, one frame per slot. A
+// slot holds the step, time, strain and stress of the frame, and then the
+// positions and the deltas (displacement in the last step) of all nodes, x
+// and y for each, in the order of Network::pos. Frame f (counted from 0)
+// goes to slot f % slots, so the ring keeps the last slots frames, and
+// header.written counts the frames published so far.
+//
+// The integrator never waits for a reader. Each slot has a sequence lock:
+// while frame f is written its sequence is 2 f + 1, and once the frame is
+// complete it is 2 f + 2. A reader copies the slot and checks that the
+// sequence was 2 f + 2 before and after the copy; if it changed, the writer
+// has overtaken the reader, and the frame is lost to it. A reader that falls
+// more than slots frames behind loses frames this way, but never sees a
+// frame that is half written.
+//
+// The file is left in place when the run ends, with header.finished set,
+// so that readers can drain the last frames. FrameReader below is all that a
+// reader needs, and integrator-follow (see follow.cpp) is an example.
+
+#include <atomic>
+#include <string>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+struct FrameRingHeader {
+
+    enum {magic_value = 0x46524d52, version_value = 1};
+
+    unsigned magic, version;
+    int pid;
+    int netSize, slots, frameSteps;
+    long long slotSize;         // Bytes per slot, with the doubles after it
+    double timestep;
+    std::atomic<long long> written;
+    std::atomic<int> finished;
+    char label[256];            // Output path of the run
+
+};
+
+struct FrameSlot {
+
+    std::atomic<long long> sequence;
+    long long frame;
+    int step;
+    double time, affdel, strain, stress;
+
+};
+
+// frameDataOffset is the offset of the positions in a slot, and
+// frameSlotSize the size of a slot for a lattice of netSize by netSize
+// nodes; slots start on cache lines.
+inline size_t frameDataOffset()
+{
+    return (sizeof(FrameSlot) + 63) / 64 * 64;
+}
+
+inline size_t frameSlotSize(int netSize)
+{
+    return (frameDataOffset() + 4 * sizeof(double) * netSize * netSize + 63) / 64 * 64;
+}
+
+inline size_t frameHeaderSize()
+{
+    return (sizeof(FrameRingHeader) + 63) / 64 * 64;
+}
+
+// FrameReader follows the frame ring of a run.
+struct FrameReader {
+
+    enum Result {frame_ok, frame_pending, frame_lost};
+
+    const FrameRingHeader *header;
+    size_t size;
+
+    FrameReader() : header(NULL), size(0) {}
+    ~FrameReader() { close(); }
+
+    // open maps the frame ring file. It returns false if the file can't be
+    // read or doesn't hold a frame ring of this version, e.g. because the
+    // integrator is still creating it.
+    bool open(std::string path) {
+        close();
+
+        int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat st;
+
+        if (fd < 0)
+            return false;
+
+        if (fstat(fd, &st) != 0 || (size_t) st.st_size < frameHeaderSize()) {
+            ::close(fd);
+            return false;
+        }
+
+        void *mem = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+
+        if (mem == MAP_FAILED)
+            return false;
+
+        header = static_cast<const FrameRingHeader *>(mem);
+        size = st.st_size;
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (header->magic != FrameRingHeader::magic_value
+                || header->version != FrameRingHeader::version_value
+                || size < frameHeaderSize() + header->slots * (size_t) header->slotSize) {
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void close() {
+        if (header != NULL)
+            munmap(const_cast<FrameRingHeader *>(header), size);
+        header = NULL;
+    }
+
+    // nodes returns the number of nodes of a frame.
+    int nodes() const { return header->netSize * header->netSize; }
+
+    // written returns the number of frames published so far.
+    long long written() const {
+        return header->written.load(std::memory_order_acquire);
+    }
+
+    // finished tells whether the run has ended, so no frames will follow
+    // those written.
+    bool finished() const {
+        return header->finished.load(std::memory_order_acquire) != 0;
+    }
+
+    // read copies frame f to info and, if they aren't NULL, its positions
+    // and deltas to pos and delta, 2 * nodes() doubles each. It returns
+    // frame_pending if the frame isn't written yet, and frame_lost if it was
+    // overwritten before or while it was copied.
+    Result read(long long f, FrameSlot &info, double *pos, double *delta) const {
+        const char *base = reinterpret_cast<const char *>(header) + frameHeaderSize()
+            + (f % header->slots) * header->slotSize;
+        const FrameSlot *slot = reinterpret_cast<const FrameSlot *>(base);
+        const double *data = reinterpret_cast<const double *>(base + frameDataOffset());
+        size_t bytes = 2 * sizeof(double) * nodes();
+
+        long long before = slot->sequence.load(std::memory_order_acquire);
+
+        if (before < 2 * f + 2)
+            return frame_pending;
+        if (before > 2 * f + 2)
+            return frame_lost;
+
+        info.frame = slot->frame;
+        info.step = slot->step;
+        info.time = slot->time;
+        info.affdel = slot->affdel;
+        info.strain = slot->strain;
+        info.stress = slot->stress;
+
+        if (pos != NULL)
+            memcpy(pos, data, bytes);
+        if (delta != NULL)
+            memcpy(delta, data + 2 * nodes(), bytes);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        return slot->sequence.load(std::memory_order_relaxed) == before
+            ? frame_ok : frame_lost;
+    }
+
+};
+
+// FrameRing publishes the frames of the integrator.
+struct FrameRing {
+
+    // FrameRing creates the frame ring file at path with room for slots
+    // frames; with an empty path, or if the file can't be created, publish
+    // does nothing.
+    FrameRing(std::string path, int slots, std::string label, int frameSteps);
+    ~FrameRing();
+
+    // publish writes the frame of step to the next slot.
+    void publish(int step, double affdel, double strain, double stress,
+            const double *pos, const double *delta);
+
+    private:
+
+    FrameRingHeader *header;
+    size_t size;
+
+};
+
+#endif /* FRAMES_H_ */
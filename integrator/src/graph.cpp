@@ -0,0 +1,373 @@
+// graph.cpp
+// ---------
+//
+// graph.cpp implements the struct Graph of graph.h and the graph mode of the
+// integrator.
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include "graph.h"
+#include "network.h"
+#include "utils.h"
+#include "print.h"
+#include "reduce.h"
+#include "status.h"
+
+Graph::Graph() :
+    nodes(0),
+    bonds(0),
+    pos(NULL), delta(NULL),
+    start(NULL), other(NULL), crossings(NULL),
+    stiffness(NULL), restLength(NULL), force(NULL),
+    inStart(NULL), inBonds(NULL),
+    shift(0.0)
+{
+}
+
+Graph::~Graph()
+{
+    delete[] pos;
+    delete[] delta;
+    delete[] start;
+    delete[] other;
+    delete[] crossings;
+    delete[] stiffness;
+    delete[] restLength;
+    delete[] force;
+    delete[] inStart;
+    delete[] inBonds;
+}
+
+// A bond as it is read from the file.
+
+struct BondLine {
+    int a, b, cross;
+    double stiffness, restLength;
+};
+
+int Graph::load(std::string fileName)
+{
+    FILE *in = fopen(fileName.c_str(), "r");
+
+    if (in == NULL)
+    {
+        printf("Couldn't open graph file %s.\n", fileName.c_str());
+        return 1;
+    }
+
+    std::vector<double> coords;
+    std::vector<BondLine> lines;
+    double width = 0.0, height = 0.0, offset = 0.0;
+    char line[1024];
+    int lineNo = 0, ret = 0;
+
+    while (ret == 0 && fgets(line, sizeof(line), in) != NULL)
+    {
+        lineNo++;
+
+        char *comment = strchr(line, '#');
+        if (comment != NULL)
+            *comment = '\0';
+
+        char key[16];
+        int used = 0;
+
+        if (sscanf(line, " %15s%n", key, &used) != 1)
+            continue;
+
+        const char *rest = line + used;
+
+        if (!strcmp(key, "box"))
+        {
+            if (sscanf(rest, "%lf %lf %lf", &width, &height, &offset) < 2
+                    || width <= 0 || height <= 0)
+                ret = 1;
+        }
+        else if (!strcmp(key, "node"))
+        {
+            double x, y;
+
+            if (sscanf(rest, "%lf %lf", &x, &y) != 2)
+                ret = 1;
+
+            coords.push_back(x);
+            coords.push_back(y);
+        }
+        else if (!strcmp(key, "bond"))
+        {
+            BondLine bond;
+            bond.cross = 0;
+
+            int n = sscanf(rest, "%d %d %lf %lf %d", &bond.a, &bond.b,
+                    &bond.stiffness, &bond.restLength, &bond.cross);
+
+            if (n < 4 || bond.restLength <= 0 || bond.cross < -1 || bond.cross > 1)
+                ret = 1;
+
+            lines.push_back(bond);
+        }
+        else
+            ret = 1;
+
+        if (ret != 0)
+            printf("%s:%d: bad line: %s", fileName.c_str(), lineNo, line);
+    }
+
+    fclose(in);
+
+    if (ret != 0)
+        return ret;
+
+    if (width <= 0)
+    {
+        printf("%s: the box is missing.\n", fileName.c_str());
+        return 1;
+    }
+
+    nodes = coords.size() / 2;
+    bonds = lines.size();
+
+    for (int b = 0; b < bonds; b++)
+    {
+        if (lines[b].a < 0 || lines[b].a >= nodes || lines[b].b < 0
+                || lines[b].b >= nodes || lines[b].a == lines[b].b)
+        {
+            printf("%s: bond %d joins nodes %d and %d of %d.\n", fileName.c_str(),
+                    b, lines[b].a, lines[b].b, nodes);
+            return 1;
+        }
+    }
+
+    boundary.width = width;
+    boundary.height = height;
+    boundary.offset = 0.0;
+    boundary.rate = 1.0;
+    boundary.advance(offset);
+
+    pos = new double[2 * nodes];
+    delta = new double[2 * nodes]();
+
+    for (int k = 0; k < 2 * nodes; k++)
+        pos[k] = coords[k];
+
+    // Sort the bonds into rows by counting, first by their first node, then
+    // by their second one for the transposed table.
+
+    start = new int[nodes + 1]();
+    inStart = new int[nodes + 1]();
+
+    for (int b = 0; b < bonds; b++)
+    {
+        start[lines[b].a + 1]++;
+        inStart[lines[b].b + 1]++;
+    }
+
+    for (int n = 0; n < nodes; n++)
+    {
+        start[n + 1] += start[n];
+        inStart[n + 1] += inStart[n];
+    }
+
+    other = new int[bonds];
+    crossings = new signed char[bonds];
+    stiffness = new double[bonds];
+    restLength = new double[bonds];
+    force = new double[2 * bonds]();
+    inBonds = new int[bonds];
+
+    std::vector<int> next(start, start + nodes), inNext(inStart, inStart + nodes);
+
+    for (int l = 0; l < bonds; l++)
+    {
+        int b = next[lines[l].a]++;
+
+        other[b] = lines[l].b;
+        crossings[b] = lines[l].cross;
+        stiffness[b] = lines[l].stiffness;
+        restLength[b] = lines[l].restLength;
+
+        inBonds[inNext[lines[l].b]++] = b;
+    }
+
+    return 0;
+}
+
+void Graph::getNetForces()
+{
+    for (int n = 0; n < nodes; n++)
+    {
+        for (int b = start[n]; b < start[n + 1]; b++)
+        {
+            int m = other[b];
+
+            double dx = boundary.dx(pos[2 * m] - pos[2 * n], crossings[b]);
+            double dy = boundary.dy(pos[2 * m + 1] - pos[2 * n + 1], crossings[b]);
+            double dist = sqrt(dx * dx + dy * dy);
+
+            double temp = stiffness[b] * (dist - restLength[b]) / restLength[b];
+
+            force[2 * b] = temp * dx / dist;
+            force[2 * b + 1] = temp * dy / dist;
+        }
+    }
+}
+
+double Graph::calcStress()
+{
+    Neumaier stress;
+
+    for (int n = 0; n < nodes; n++)
+    {
+        for (int b = start[n]; b < start[n + 1]; b++)
+        {
+            double ydist = boundary.dy(pos[2 * other[b] + 1] - pos[2 * n + 1],
+                    crossings[b]);
+
+            stress.add(force[2 * b] * ydist);
+        }
+    }
+
+    return stress.value() / (boundary.width * boundary.height);
+}
+
+void Graph::moveNodes(double shear_rate, double temp)
+{
+    double d = KB * temp / (6 * PI * ETA * RADIUS);
+    double sigma = sqrt(2 * d * TIMESTEP);
+    double gamma = 4 * PI * ETA * RADIUS;
+    double middle = boundary.height / 2.0;
+
+    // The image above the box moves with the solvent at the top of the box
+    // relative to the bottom.
+
+    shift += shear_rate * boundary.height * TIMESTEP;
+    boundary.advance(shear_rate * boundary.height * TIMESTEP);
+
+    for (int n = 0; n < nodes; n++)
+    {
+        double netx = 0.0, nety = 0.0;
+
+        for (int b = start[n]; b < start[n + 1]; b++)
+        {
+            netx += force[2 * b];
+            nety += force[2 * b + 1];
+        }
+
+        for (int k = inStart[n]; k < inStart[n + 1]; k++)
+        {
+            netx -= force[2 * inBonds[k]];
+            nety -= force[2 * inBonds[k] + 1];
+        }
+
+        double affvel = shear_rate * (pos[2 * n + 1] - middle);
+
+        delta[2 * n] = TIMESTEP * (netx / gamma + affvel);
+        delta[2 * n + 1] = TIMESTEP * (nety / gamma);
+
+        if (temp > 1e-15)
+        {
+            double theta = 2 * PI * randDouble(0, 1);
+            double r = sigma * sqrt(-2 * log(randDouble(0, 1)));
+
+            delta[2 * n] += r * cos(theta);
+            delta[2 * n + 1] += r * sin(theta);
+        }
+
+        pos[2 * n] = boundary.wrap(pos[2 * n] + delta[2 * n]);
+        pos[2 * n + 1] += delta[2 * n + 1];
+    }
+}
+
+double Graph::energy()
+{
+    Neumaier funcvalue;
+
+    for (int n = 0; n < nodes; n++)
+    {
+        for (int b = start[n]; b < start[n + 1]; b++)
+        {
+            int m = other[b];
+
+            double dx = boundary.dx(pos[2 * m] - pos[2 * n], crossings[b]);
+            double dy = boundary.dy(pos[2 * m + 1] - pos[2 * n + 1], crossings[b]);
+            double delta = sqrt(dx * dx + dy * dy) - restLength[b];
+
+            funcvalue.add(0.5 * stiffness[b] / restLength[b] * delta * delta);
+        }
+    }
+
+    return funcvalue.value();
+}
+
+int integrateGraph(const Options &opts, int nTimeSteps, const Protocol &protocol,
+        std::string root_path)
+{
+    Graph graph;
+
+    if (graph.load(opts.graphFileName))
+        return 1;
+
+    if (!opts.posFileName.empty() || !opts.nonaffFileName.empty()
+            || !opts.renderFileName.empty())
+        printf("Position, nonaffinity and rendered output are not written in"
+               " graph mode.\n");
+
+    printf("Integrating a graph of %d nodes and %d bonds.\n", graph.nodes,
+            graph.bonds);
+
+    OutFile stressFile, energyFile;
+    stressFile.precision = energyFile.precision = opts.precision;
+
+    if (!opts.stressFileName.empty())
+        stressFile.open(root_path + "/" + opts.stressFileName + ".txt", "w");
+
+    if (!opts.energyFileName.empty())
+        energyFile.open(root_path + "/" + opts.energyFileName + ".txt", "a");
+
+    // Progress is published for integrator-top as for the lattice (see
+    // status.h).
+
+    Telemetry telemetry(opts.status_dir, root_path, nTimeSteps, frame_sep);
+
+    for (int i = 0; i < nTimeSteps; i++)
+    {
+        double strain = graph.strain();
+
+        graph.getNetForces();
+        double stress = graph.calcStress();
+
+        if (stress != stress)
+        {
+            printf("Stress has gone to NaN.\n");
+            printf("w = %.4g, e = %.2g\n", opts.strRate, opts.initStrain);
+            return 2;
+        }
+
+        if (i % frame_sep == 0)
+        {
+            printf("/");
+            fflush(stdout);
+
+            if (stressFile.is_open())
+            {
+                stressFile << stress << "," << strain << ",";
+                stressFile.put(i * TIMESTEP, 0);
+                stressFile << "\n";
+                stressFile.flush();
+            }
+
+            telemetry.update(i, graph.shift, strain, stress, 0.0, 0.0, 1);
+        }
+
+        graph.moveNodes(protocol.rate(i), opts.temp);
+    }
+
+    printf("\n");
+
+    if (energyFile.is_open())
+        energyFile << graph.energy() << "," << opts.pBond << "," << graph.strain() << "\n";
+
+    return 0;
+}
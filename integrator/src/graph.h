@@ -0,0 +1,95 @@
+#ifndef GRAPH_H_
+#define GRAPH_H_
+
+// graph.h
+// -------
+//
+// graph.h defines the struct Graph, a network of arbitrary topology: any
+// number of nodes, joined by bonds with their own stiffness and rest length,
+// e.g. a Mikado or random fiber network or a reconstructed one. Network, by
+// contrast, is always the triangular lattice.
+//
+// A graph is read from a text file with one item per line ("#" starts a
+// comment):
+//
+//   box width height [offset]      The periodic box (required), and the
+//                                  shift in x of its image above (0)
+//   node x y                       The next node, numbered from 0
+//   bond a b stiffness restlength [cross]
+//                                  A bond between nodes a and b
+//
+// Like Network, the box is a sheared periodic boundary (see leesedwards.h).
+// cross is the number of times the bond crosses the top of the box going
+// from a to b (-1, 0 or 1, default 0); in x, every bond is taken to the
+// nearest periodic image, so bonds must be shorter than half the width. The
+// force of a bond is stiffness * (length - restlength) / restlength, as for
+// the springs of Network.
+//
+// The bonds are stored in compressed sparse row (CSR) form: the bonds of node
+// n are start[n] to start[n + 1] - 1, each bond being stored once, with its
+// first node a. The transposed table (inStart and inBonds) lists the bonds
+// that end at each node, so that moveNodes gathers the net force on a node
+// without writing to any other.
+
+#include <string>
+#include "options.h"
+#include "protocol.h"
+#include "leesedwards.h"
+
+extern double TIMESTEP;
+extern int frame_sep;
+
+struct Graph {
+
+    int nodes, bonds;
+
+    double *pos;            // [2 * nodes], x and y of each node
+    double *delta;          // [2 * nodes], displacement in the last step
+
+    int *start;             // [nodes + 1]
+    int *other;             // [bonds], node at the far end of each bond
+    signed char *crossings; // [bonds]
+    double *stiffness;      // [bonds]
+    double *restLength;     // [bonds]
+    double *force;          // [2 * bonds], force of each bond on its first node
+
+    int *inStart;           // [nodes + 1]
+    int *inBonds;           // [bonds]
+
+    LeesEdwards boundary;
+    double shift;           // Total shear displacement of the image above
+
+    Graph();
+    ~Graph();
+
+    // load reads the graph from the file. It returns 0, or prints what is
+    // wrong with the file and returns 1.
+    int load(std::string fileName);
+
+    // The kernels do the same as those of Network. shear_rate is the strain
+    // rate, and the solvent flows in x with shear_rate times the height of a
+    // node above the middle of the box.
+    void getNetForces();
+    double calcStress();
+    void moveNodes(double shear_rate, double temp);
+
+    // energy returns the elastic energy of the bonds.
+    double energy();
+
+    // strain returns the shear strain applied so far, the shift of the
+    // image above over the height of the box. This is what the stress file
+    // of a graph holds. For the lattice, the strain written is (netSize - 1)
+    // / netSize of the shear of its box (see response.h), so the moduli of
+    // a lattice given as a graph are that factor times those of the lattice.
+    double strain() const { return shift / boundary.height; }
+
+};
+
+// integrateGraph runs the simulation of integrator.cpp for the graph in
+// opts.graphFileName, writing its stress and energy files. It returns the
+// exit status of the integrator; like the lattice, a stress that has gone to
+// NaN ends the run with status 2.
+int integrateGraph(const Options &opts, int nTimeSteps, const Protocol &protocol,
+        std::string root_path);
+
+#endif /* GRAPH_H_ */
@@ -0,0 +1,144 @@
+// health.cpp
+// ----------
+//
+// health.cpp implements the health monitor of health.h.
+
+#include <cstdio>
+#include <cstring>
+#include "health.h"
+
+Health::Health(Network &nnet, Motors *mmotors, StressControl *ccontrol,
+        int iinterval, int ddepth, double mmaxStep, int bbegin, int eend) :
+    interval(iinterval),
+    maxStep(mmaxStep),
+    substeps(1),
+    net(nnet),
+    motors(mmotors),
+    control(ccontrol),
+    begin(bbegin),
+    end(eend),
+    depth(ddepth > 0 ? ddepth : 1),
+    newest(0),
+    count(0),
+    failedAt(-1)
+{
+    int rows = 2 * (end - begin) * netSize;
+
+    ring = new State[depth];
+
+    for (int s = 0; s < depth; s++)
+    {
+        ring[s].step = -1;
+        ring[s].pos = interval > 0 ? new double[rows] : NULL;
+        ring[s].delta = interval > 0 ? new double[rows] : NULL;
+        ring[s].motors = interval > 0 && motors != NULL
+            ? new double[3 * netSize * netSize] : NULL;
+        ring[s].nonAff = interval > 0 ? new double[2 * (end - begin)] : NULL;
+    }
+}
+
+Health::~Health()
+{
+    for (int s = 0; s < depth; s++)
+    {
+        delete[] ring[s].pos;
+        delete[] ring[s].delta;
+        delete[] ring[s].motors;
+        delete[] ring[s].nonAff;
+    }
+
+    delete[] ring;
+}
+
+void Health::save(int step, const Printer::Mark &mark)
+{
+    // A state that was just restored is saved again in its own place.
+
+    if (count == 0 || ring[newest].step != step)
+    {
+        if (count > 0)
+            newest = (newest + 1) % depth;
+        if (count < depth)
+            count++;
+
+        if (substeps > 1 && step > failedAt)
+            substeps /= 2;
+    }
+
+    State &state = ring[newest];
+    size_t first = 2 * begin * netSize, size = 2 * (end - begin) * netSize;
+
+    state.step = step;
+    state.affdel = affdel;
+    state.boundary = net.boundary;
+    state.mark = mark;
+
+    memcpy(state.pos, net.pos + first, size * sizeof(double));
+    memcpy(state.delta, net.delta + first, size * sizeof(double));
+    memcpy(state.nonAff, net.rowNonAff + begin, (end - begin) * sizeof(double));
+    memcpy(state.nonAff + end - begin, net.rowNonAffdd + begin,
+            (end - begin) * sizeof(double));
+
+    if (motors != NULL)
+        motors->save(state.motors);
+
+    if (control != NULL)
+        control->save(state.control);
+
+    net.maxDelta = 0.0;
+}
+
+int Health::rollback(int step, const char *reason)
+{
+    if (step > failedAt)
+        failedAt = step;
+
+    substeps *= 2;
+
+    // At the most substeps, the newest state is given up and the one before
+    // it is tried.
+
+    if (substeps > max_substeps)
+    {
+        substeps = max_substeps;
+        newest = (newest + depth - 1) % depth;
+        count--;
+    }
+
+    if (count <= 0)
+    {
+        if (net.iBegin == 0)
+            printf("\nStep %d: %s, and no saved state is left to retry from"
+                   " (%d substeps per step).\n", step, reason, substeps);
+        return -1;
+    }
+
+    if (net.iBegin == 0)
+        printf("\nStep %d: %s; retrying from step %d with %d substeps per step.\n",
+                step, reason, ring[newest].step, substeps);
+
+    restore(ring[newest]);
+    return ring[newest].step;
+}
+
+void Health::restore(const State &state)
+{
+    size_t first = 2 * begin * netSize, size = 2 * (end - begin) * netSize;
+
+    memcpy(net.pos + first, state.pos, size * sizeof(double));
+    memcpy(net.delta + first, state.delta, size * sizeof(double));
+    memcpy(net.rowNonAff + begin, state.nonAff, (end - begin) * sizeof(double));
+    memcpy(net.rowNonAffdd + begin, state.nonAff + end - begin,
+            (end - begin) * sizeof(double));
+
+    affdel = state.affdel;
+    net.boundary = state.boundary;
+
+    if (motors != NULL)
+        motors->restore(state.motors);
+
+    if (control != NULL)
+        control->restore(state.control);
+
+    net.maxDelta = 0.0;
+}
@@ -0,0 +1,93 @@
+#ifndef HEALTH_H_
+#define HEALTH_H_
+
+// health.h
+// --------
+//
+// health.h defines the struct Health, the health monitor of the integrator.
+// Instead of checking every coordinate for NaN and aborting, moveNodes keeps
+// the largest nonaffine displacement of a node in one step (maxDelta of
+// Network, which is NaN once any node has gone to NaN), and every interval
+// steps the integrator compares it with a limit. A stress of NaN counts as
+// a failure as soon as it is computed.
+//
+// At every healthy check the state at the start of the step is saved in a
+// small ring of depth states: the positions and deltas of the rows of this
+// process with their nonaffinity sums, affdel, the boundary, the motors, the
+// stress controller and how far the output files had been written. After a failure the newest
+// state is restored and the steps are integrated again with the time step
+// split into twice as many substeps (the strain rate of each step is kept
+// for all its substeps). If that fails at max_substeps, the next older state
+// is tried. Once no saved state is left, the run stops with a description of
+// what went wrong. After every healthy interval past the failure the number
+// of substeps is halved again.
+//
+// The random numbers of the thermal noise and the motors are not restored,
+// so a retried stretch sees other noise, and frames that were rendered
+// before a rollback are rendered again.
+
+#include "network.h"
+#include "motors.h"
+#include "print.h"
+#include "protocol.h"
+
+struct Health {
+
+    enum {max_substeps = 64};
+
+    int interval;   // Steps between checks (0, no rollback)
+    double maxStep; // Largest healthy nonaffine displacement in one step
+    int substeps;   // Substeps per step, 1 unless recovering
+
+    // Health saves the rows [begin, end) of net, and motors and control
+    // unless NULL.
+    Health(Network &net, Motors *motors, StressControl *control, int interval,
+            int depth, double maxStep, int begin, int end);
+    ~Health();
+
+    // due is true if step i starts with a check.
+    bool due(int i) const { return interval > 0 && i % interval == 0; }
+
+    // healthy is true if worst, maxDelta of all processes since the last
+    // check, is within the limit.
+    bool healthy(double worst) const { return worst == worst && worst <= maxStep; }
+
+    // save saves the state at the start of step, with the output files
+    // written up to mark, and starts the next interval.
+    void save(int step, const Printer::Mark &mark);
+
+    // rollback restores the state to retry from after a failure at step, for
+    // the reason given, and returns the step it was saved at. It returns -1
+    // if there is none left.
+    int rollback(int step, const char *reason);
+
+    // mark is how far the output files had been written in the restored
+    // state.
+    const Printer::Mark &mark() const { return ring[newest].mark; }
+
+    private:
+
+    struct State {
+        int step;
+        double affdel;
+        LeesEdwards boundary;
+        double *pos, *delta, *motors;
+        double *nonAff;     // rowNonAff and rowNonAffdd of the rows
+        double control[StressControl::num_state];
+        Printer::Mark mark;
+    };
+
+    Network &net;
+    Motors *motors;
+    StressControl *control;
+    int begin, end;
+    int depth;
+    State *ring;
+    int newest, count;
+    int failedAt;   // Step of the last failure
+
+    void restore(const State &state);
+
+};
+
+#endif /* HEALTH_H_ */
@@ -0,0 +1,495 @@
+// hydro.cpp
+// ---------
+//
+// hydro.cpp implements the struct Hydro of hydro.h.
+
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <utility>
+#include "hydro.h"
+#include "network.h"
+
+typedef std::complex<double> cplx;
+
+// Width of the blobs, for which the self-mobility of the Stokes flow of the
+// plane is 3 sqrt(pi) / (32 pi ETA SIGMA) = 1 / (4 pi ETA RADIUS).
+static const double SIGMA = 3.0 * sqrt(PI) / 8.0 * RADIUS;
+
+// The blobs are cut off at CUTOFF * SIGMA, where they have fallen to e^-8,
+// and the grid spacing is at most SPACING * SIGMA. The mobility then changes
+// by about 1e-5 of itself as a node moves over the grid.
+static const double CUTOFF = 4.0;
+static const double SPACING = 2.0 / 3.0;
+
+// The Lanczos iteration stops when the estimate of M^(1/2) xi changes by
+// less than LANCZOS_TOL relative to its length.
+static const double LANCZOS_TOL = 1e-3;
+
+static int nextPow2(double x)
+{
+    int n = 8;
+
+    while (n < x)
+        n *= 2;
+
+    return n;
+}
+
+// fft transforms the n values of a in place (n a power of two), with the
+// twiddle factors exp(-2 pi i k / n), k < n / 2. The inverse transform is not
+// normalized.
+
+static void fft(cplx *a, int n, const cplx *twiddle, bool inverse)
+{
+    for (int i = 1, j = 0; i < n; i++)
+    {
+        int bit = n >> 1;
+
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+
+        j ^= bit;
+
+        if (i < j)
+            std::swap(a[i], a[j]);
+    }
+
+    for (int len = 2; len <= n; len *= 2)
+    {
+        int step = n / len;
+
+        for (int i = 0; i < n; i += len)
+        {
+            for (int k = 0; k < len / 2; k++)
+            {
+                cplx w = inverse ? std::conj(twiddle[k * step]) : twiddle[k * step];
+                cplx u = a[i + k];
+                cplx v = a[i + k + len / 2] * w;
+
+                a[i + k] = u + v;
+                a[i + k + len / 2] = u - v;
+            }
+        }
+    }
+}
+
+// sqrtTridiagonal sets y to T^(1/2) e1 for the symmetric tridiagonal matrix
+// T of m rows with the diagonal alpha and the off-diagonal beta, from the
+// eigenvectors of T found by the Jacobi method.
+
+static void sqrtTridiagonal(const double *alpha, const double *beta, int m, double *y)
+{
+    std::vector<double> a(m * m, 0.0), v(m * m, 0.0);
+
+    for (int i = 0; i < m; i++)
+    {
+        a[i * m + i] = alpha[i];
+        v[i * m + i] = 1.0;
+
+        if (i + 1 < m)
+            a[i * m + i + 1] = a[(i + 1) * m + i] = beta[i];
+    }
+
+    for (int sweep = 0; sweep < 50; sweep++)
+    {
+        double off = 0.0, diag = 0.0;
+
+        for (int p = 0; p < m; p++)
+        {
+            diag += a[p * m + p] * a[p * m + p];
+
+            for (int q = p + 1; q < m; q++)
+                off += a[p * m + q] * a[p * m + q];
+        }
+
+        if (off <= 1e-30 * diag)
+            break;
+
+        for (int p = 0; p < m; p++)
+        {
+            for (int q = p + 1; q < m; q++)
+            {
+                double apq = a[p * m + q];
+
+                if (apq == 0.0)
+                    continue;
+
+                double theta = (a[q * m + q] - a[p * m + p]) / (2.0 * apq);
+                double t = (theta >= 0 ? 1.0 : -1.0)
+                    / (std::abs(theta) + sqrt(theta * theta + 1.0));
+                double c = 1.0 / sqrt(t * t + 1.0);
+                double s = t * c;
+
+                for (int k = 0; k < m; k++)
+                {
+                    double akp = a[k * m + p], akq = a[k * m + q];
+                    a[k * m + p] = c * akp - s * akq;
+                    a[k * m + q] = s * akp + c * akq;
+                }
+
+                for (int k = 0; k < m; k++)
+                {
+                    double apk = a[p * m + k], aqk = a[q * m + k];
+                    a[p * m + k] = c * apk - s * aqk;
+                    a[q * m + k] = s * apk + c * aqk;
+                }
+
+                for (int k = 0; k < m; k++)
+                {
+                    double vkp = v[k * m + p], vkq = v[k * m + q];
+                    v[k * m + p] = c * vkp - s * vkq;
+                    v[k * m + q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+
+    // T^(1/2) e1 = sum over the eigenvectors u of sqrt(lambda) u u[0]. M is
+    // positive definite, so negative eigenvalues are rounding errors.
+
+    for (int i = 0; i < m; i++)
+        y[i] = 0.0;
+
+    for (int k = 0; k < m; k++)
+    {
+        double lambda = a[k * m + k];
+        double root = lambda > 0.0 ? sqrt(lambda) : 0.0;
+
+        for (int i = 0; i < m; i++)
+            y[i] += root * v[i * m + k] * v[k];
+    }
+}
+
+Hydro::Hydro(int nnodes, const LeesEdwards &boundary) :
+    nodes(nnodes),
+    width(boundary.width),
+    height(boundary.height),
+    tilt(0.0)
+{
+    mx = nextPow2(width / (SPACING * SIGMA));
+    my = nextPow2(height / (SPACING * SIGMA));
+    ds = width / mx;
+    dy = height / my;
+
+    double spacing = ds < dy ? ds : dy;
+    support = (int) ceil(2.0 * CUTOFF * SIGMA / spacing) + 1;
+
+    grid = new cplx[mx * my];
+    column = new cplx[my];
+    twiddleX = new cplx[mx / 2];
+    twiddleY = new cplx[my / 2];
+
+    for (int k = 0; k < mx / 2; k++)
+        twiddleX[k] = std::polar(1.0, -2.0 * PI * k / mx);
+
+    for (int k = 0; k < my / 2; k++)
+        twiddleY[k] = std::polar(1.0, -2.0 * PI * k / my);
+
+    rowStart = new int[nodes];
+    colStart = new int[nodes * support];
+    weights = new double[nodes * support * support];
+
+    basis = new double[(max_lanczos + 1) * 2 * nodes];
+    previous = new double[max_lanczos];
+
+    printf("Hydrodynamic interactions on a %d x %d grid, %d x %d points per node.\n",
+            mx, my, support, support);
+}
+
+Hydro::~Hydro()
+{
+    delete[] grid;
+    delete[] column;
+    delete[] twiddleX;
+    delete[] twiddleY;
+    delete[] rowStart;
+    delete[] colStart;
+    delete[] weights;
+    delete[] basis;
+    delete[] previous;
+}
+
+void Hydro::setPositions(const double *pos, const LeesEdwards &boundary)
+{
+    // The shift of the image above, taken between -width / 2 and width / 2,
+    // so that the grid is tilted as little as possible.
+
+    double offset = boundary.image(boundary.offset);
+    tilt = offset / height;
+
+    double reach = CUTOFF * SIGMA;
+    double norm = 1.0 / (2.0 * PI * SIGMA * SIGMA);
+
+    for (int n = 0; n < nodes; n++)
+    {
+        double x = pos[2 * n];
+        double y = pos[2 * n + 1];
+
+        int b0 = (int) ceil((y - reach) / dy);
+        rowStart[n] = b0;
+
+        for (int r = 0; r < support; r++)
+        {
+            // Grid point (a, b) lies at (a * ds + tilt * b * dy, b * dy).
+
+            double ry = (b0 + r) * dy - y;
+            double shift = tilt * (b0 + r) * dy;
+            int a0 = (int) ceil((x - shift - reach) / ds);
+
+            colStart[n * support + r] = a0;
+
+            double *w = weights + (n * support + r) * support;
+
+            for (int c = 0; c < support; c++)
+            {
+                double rx = (a0 + c) * ds + shift - x;
+                w[c] = norm * exp(-(rx * rx + ry * ry) / (2.0 * SIGMA * SIGMA));
+            }
+        }
+    }
+}
+
+void Hydro::spread(const double *force)
+{
+    for (int k = 0; k < mx * my; k++)
+        grid[k] = 0.0;
+
+    for (int n = 0; n < nodes; n++)
+    {
+        cplx f = force != NULL ? cplx(force[2 * n], force[2 * n + 1]) : cplx(1.0, 0.0);
+
+        for (int r = 0; r < support; r++)
+        {
+            cplx *row = grid + ((rowStart[n] + r) & (my - 1)) * mx;
+            const double *w = weights + (n * support + r) * support;
+            int a0 = colStart[n * support + r];
+
+            for (int c = 0; c < support; c++)
+                row[(a0 + c) & (mx - 1)] += w[c] * f;
+        }
+    }
+}
+
+void Hydro::interpolate(double scale, double *out)
+{
+    scale *= ds * dy;
+
+    for (int n = 0; n < nodes; n++)
+    {
+        cplx v = 0.0;
+
+        for (int r = 0; r < support; r++)
+        {
+            const cplx *row = grid + ((rowStart[n] + r) & (my - 1)) * mx;
+            const double *w = weights + (n * support + r) * support;
+            int a0 = colStart[n * support + r];
+
+            for (int c = 0; c < support; c++)
+                v += w[c] * row[(a0 + c) & (mx - 1)];
+        }
+
+        out[2 * n] += scale * v.real();
+        out[2 * n + 1] += scale * v.imag();
+    }
+}
+
+void Hydro::solve(bool gradient)
+{
+    for (int b = 0; b < my; b++)
+        fft(grid + b * mx, mx, twiddleX, false);
+
+    for (int a = 0; a < mx; a++)
+    {
+        for (int b = 0; b < my; b++)
+            column[b] = grid[b * mx + a];
+
+        fft(column, my, twiddleY, false);
+
+        for (int b = 0; b < my; b++)
+            grid[b * mx + a] = column[b];
+    }
+
+    // The grid holds fx + i fy (or the density), so the transforms of fx and
+    // fy are the even and odd parts of its transform; those of ux and uy are
+    // packed the same way. The transform of the sheared grid at (p, q) is
+    // that of the solvent at kx = 2 pi p / width, ky = 2 pi q / height -
+    // tilt kx.
+
+    double norm = 1.0 / (mx * my);
+
+    for (int q = 0; q < my; q++)
+    {
+        for (int p = 0; p < mx; p++)
+        {
+            int k = q * mx + p;
+            int mk = ((my - q) & (my - 1)) * mx + ((mx - p) & (mx - 1));
+
+            if (!gradient && mk < k)
+                continue;
+
+            // The mean flow and the Nyquist modes, which have no partner of
+            // the opposite wave vector, are left out.
+
+            if ((p == 0 && q == 0) || p == mx / 2 || q == my / 2)
+            {
+                grid[k] = grid[mk] = 0.0;
+                continue;
+            }
+
+            double kx = 2.0 * PI * (p < mx / 2 ? p : p - mx) / width;
+            double ky = 2.0 * PI * (q < my / 2 ? q : q - my) / height - tilt * kx;
+            double k2 = kx * kx + ky * ky;
+            double c = norm / (2.0 * ETA * sqrt(k2));
+
+            double gxx = c * (1.0 - kx * kx / (2.0 * k2));
+            double gxy = -c * kx * ky / (2.0 * k2);
+            double gyy = c * (1.0 - ky * ky / (2.0 * k2));
+
+            if (gradient)
+            {
+                // The force density is minus the gradient of the density.
+
+                cplx fx = cplx(0.0, -kx) * grid[k];
+                cplx fy = cplx(0.0, -ky) * grid[k];
+
+                grid[k] = gxx * fx + gxy * fy + cplx(0.0, 1.0) * (gxy * fx + gyy * fy);
+            }
+            else
+            {
+                cplx z = grid[k], mz = grid[mk];
+
+                cplx fx = 0.5 * (z + std::conj(mz));
+                cplx fy = cplx(0.0, -0.5) * (z - std::conj(mz));
+
+                cplx ux = gxx * fx + gxy * fy;
+                cplx uy = gxy * fx + gyy * fy;
+
+                grid[k] = ux + cplx(0.0, 1.0) * uy;
+                grid[mk] = std::conj(ux) + cplx(0.0, 1.0) * std::conj(uy);
+            }
+        }
+    }
+
+    for (int a = 0; a < mx; a++)
+    {
+        for (int b = 0; b < my; b++)
+            column[b] = grid[b * mx + a];
+
+        fft(column, my, twiddleY, true);
+
+        for (int b = 0; b < my; b++)
+            grid[b * mx + a] = column[b];
+    }
+
+    for (int b = 0; b < my; b++)
+        fft(grid + b * mx, mx, twiddleX, true);
+}
+
+void Hydro::apply(const double *force, double *vel)
+{
+    for (int k = 0; k < 2 * nodes; k++)
+        vel[k] = 0.0;
+
+    spread(force);
+    solve(false);
+    interpolate(1.0, vel);
+}
+
+void Hydro::drift(double scale, double *out)
+{
+    spread(NULL);
+    solve(true);
+    interpolate(scale, out);
+}
+
+int Hydro::noise(double scale, double *out)
+{
+    int size = 2 * nodes;
+    double alpha[max_lanczos], beta[max_lanczos], y[max_lanczos];
+
+    // The first Lanczos vector is xi / |xi|.
+
+    double *v = basis;
+    double xinorm = 0.0;
+
+    for (int k = 0; k < size; k += 2)
+    {
+        double theta = 2 * PI * randDouble(0, 1);
+        double r = sqrt(-2 * log(randDouble(0, 1)));
+
+        v[k] = r * cos(theta);
+        v[k + 1] = r * sin(theta);
+        xinorm += r * r;
+    }
+
+    xinorm = sqrt(xinorm);
+
+    for (int k = 0; k < size; k++)
+        v[k] /= xinorm;
+
+    int m = 0;
+
+    while (m < max_lanczos)
+    {
+        double *w = basis + (m + 1) * size;
+        v = basis + m * size;
+
+        apply(v, w);
+
+        alpha[m] = 0.0;
+        for (int k = 0; k < size; k++)
+            alpha[m] += v[k] * w[k];
+
+        // Full reorthogonalization against all the earlier vectors.
+
+        for (int l = 0; l <= m; l++)
+        {
+            const double *u = basis + l * size;
+            double dot = 0.0;
+
+            for (int k = 0; k < size; k++)
+                dot += u[k] * w[k];
+            for (int k = 0; k < size; k++)
+                w[k] -= dot * u[k];
+        }
+
+        m++;
+        sqrtTridiagonal(alpha, beta, m, y);
+
+        double change = 0.0, length = 0.0;
+
+        for (int i = 0; i < m; i++)
+        {
+            double d = y[i] - (i < m - 1 ? previous[i] : 0.0);
+            change += d * d;
+            length += y[i] * y[i];
+            previous[i] = y[i];
+        }
+
+        double b = 0.0;
+        for (int k = 0; k < size; k++)
+            b += w[k] * w[k];
+        b = sqrt(b);
+
+        if (change <= LANCZOS_TOL * LANCZOS_TOL * length || b <= 1e-14 * sqrt(length))
+            break;
+
+        beta[m - 1] = b;
+        for (int k = 0; k < size; k++)
+            w[k] /= b;
+    }
+
+    // M^(1/2) xi ~ |xi| V y.
+
+    for (int l = 0; l < m; l++)
+    {
+        const double *u = basis + l * size;
+        double coeff = scale * xinorm * y[l];
+
+        for (int k = 0; k < size; k++)
+            out[k] += coeff * u[k];
+    }
+
+    return m;
+}
@@ -0,0 +1,102 @@
+#ifndef HYDRO_H_
+#define HYDRO_H_
+
+// hydro.h
+// -------
+//
+// hydro.h defines the struct Hydro, which couples the motion of the nodes
+// through the solvent (hydrodynamic interactions, --hydro). Without it, each
+// node feels its own Stokes drag, gamma = 4 pi ETA RADIUS, and nothing else.
+// With it, the velocities of the nodes are v = M F, where M is the mobility
+// matrix of all nodes together: a force on one node also drags the others.
+//
+// The network lies in a plane of a three-dimensional solvent, which is
+// periodic with the sheared box of the network. M is the Rotne-Prager-
+// Yamakawa-like mobility of the force coupling method: the force of each
+// node is spread over the solvent as a Gaussian blob of width SIGMA, the
+// Stokes equations are solved in Fourier space, and the velocity of the
+// solvent is averaged over the same blob. In Fourier space the in-plane
+// Stokes flow of the plane is (I - k k / (2 k^2)) / (2 ETA k), so one product
+// M F costs two FFTs of a grid over the box and the spreading, which is
+// O(N log N) for N nodes instead of the O(N^2) of summing over all pairs.
+// SIGMA is chosen so that an isolated node has the mobility 1 / gamma of the
+// free-draining model; only the coupling is new. In the periodic box the
+// flow of a node's own images lowers it by a fraction of order SIGMA / width
+// (10% for netSize 32).
+//
+// The grid is laid out in sheared coordinates (x - tilt * y, y), in which
+// the Lees-Edwards box is an ordinary periodic rectangle; its wave vectors
+// are mapped back to the laboratory frame before the Stokes solve.
+//
+// The Brownian displacements must have the covariance 2 kT M dt, so they are
+// sqrt(2 kT dt) M^(1/2) xi for a vector xi of independent normal numbers.
+// M^(1/2) xi is found by the Lanczos method, which only needs products M v:
+// it builds an orthonormal basis V of the Krylov space of M and xi, in which
+// M is the tridiagonal matrix T, and M^(1/2) xi ~ |xi| V T^(1/2) e1. Since M
+// depends on the positions, the overdamped step also has the drift
+// kT div M, which is computed spectrally as well.
+
+#include <complex>
+#include "leesedwards.h"
+
+struct Hydro {
+
+    // Hydro sets up the grid for nodes nodes in the box of boundary.
+    Hydro(int nodes, const LeesEdwards &boundary);
+    ~Hydro();
+
+    // setPositions computes the spreading weights of the nodes at pos in the
+    // given boundary. The other methods use the positions of the last call.
+    void setPositions(const double *pos, const LeesEdwards &boundary);
+
+    // apply sets vel to M force.
+    void apply(const double *force, double *vel);
+
+    // drift adds scale * div M to out.
+    void drift(double scale, double *out);
+
+    // noise adds scale * M^(1/2) xi to out, for a new random xi. It returns
+    // the number of Lanczos steps needed.
+    int noise(double scale, double *out);
+
+    private:
+
+    enum {max_lanczos = 64};
+
+    int nodes;
+    int mx, my;             // Grid size, powers of two
+    double ds, dy;          // Grid spacing in sheared x and in y
+    double width, height, tilt;
+    int support;            // Grid points per dimension in a node's blob
+
+    std::complex<double> *grid;
+    std::complex<double> *column;   // One column of the grid, for the FFT
+    std::complex<double> *twiddleX, *twiddleY;
+
+    // The blob of node n covers support rows starting at row rowStart[n];
+    // row r starts at column colStart[n * support + r], and its weights are
+    // weights[(n * support + r) * support + c].
+    int *rowStart;
+    int *colStart;
+    double *weights;
+
+    // Lanczos vectors, max_lanczos + 1 of them, and the coefficients of the
+    // last estimate of M^(1/2) xi in them.
+    double *basis;
+    double *previous;
+
+    // spread spreads the forces (x and y of every node) over the grid, or
+    // a blob of unit density per node if force is NULL.
+    void spread(const double *force);
+
+    // solve replaces the spread forces by the velocity of the solvent, or
+    // a spread density by the velocity driven by minus its gradient.
+    void solve(bool gradient);
+
+    // interpolate adds scale times the average velocity over the blob of
+    // every node to out.
+    void interpolate(double scale, double *out);
+
+};
+
+#endif /* HYDRO_H_ */
@@ -26,6 +26,18 @@ namespace po = boost::program_options;
 #include "nonaffinity.h"
 #include "print.h"
 #include "options.h"
+#include "domain.h"
+#include "timers.h"
+#include "render.h"
+#include "replicas.h"
+#include "tune.h"
+#include "graph.h"
+#include "hydro.h"
+#include "health.h"
+#include "status.h"
+#include "frames.h"
+#include "protocol.h"
+#include "response.h"
 
 // Rest length for springs.
 const double RESTLEN = 1.0;
@@ -65,7 +77,13 @@ int main (int argc, char *argv[])
         steps_per_oscillation,              // Exactly what you think it is
         out_per_oscillation = myOptions.out_per_oscillation, // How many times to output per oscillation
         num_osc = myOptions.num_osc, // Number of oscillations
-        motors = myOptions.motors;      // Use motors (1)
+        motors = myOptions.motors,      // Use motors (1)
+        procs = myOptions.procs,        // Number of processes (1)
+        timer_frames = myOptions.timer_frames, // Frames between timer lines (0)
+        nonaff_steps = myOptions.nonaff_steps, // Steps between nonaffinity samples
+        precision = myOptions.precision, // Significant digits in output files
+        render_width = myOptions.render_width, // Width of rendered frames
+        render_stream = myOptions.render_stream; // One file of frames per coloring
 
     double pBond = myOptions.pBond,             // Bond probability (0.8)
            strRate = myOptions.strRate,           // Strain rate (1.0 Hz*)
@@ -78,11 +96,28 @@ int main (int argc, char *argv[])
            posFileName = myOptions.posFileName,    // Position file name
            nonaffFileName = myOptions.nonaffFileName, // Nonaffinity file name
            stressFileName = myOptions.stressFileName, // Stress file name
+           renderFileName = myOptions.renderFileName, // Rendered frame file name
            output_path = myOptions.output_path,    // Output path for simulation
            config_file = myOptions.config_file,    // Name and location of config file
            job = myOptions.job,            // Job (only used on della) (0)
            extension = ".txt"; // File extension (".txt")
 
+    // Check the colorings of the rendered frames.
+
+    std::vector<Renderer::Coloring> render_colors;
+
+    for (size_t c = 0; c < myOptions.render_colors.size(); c++)
+    {
+      render_colors.push_back(Renderer::parseColoring(myOptions.render_colors[c]));
+
+      if (render_colors.back() == Renderer::num_colorings)
+      {
+        std::cout << "Unknown render coloring " << myOptions.render_colors[c]
+            << ". Use tension or nonaffine.\n";
+        return 1;
+      }
+    }
+
     // Set the time step.
 
     test_step = 2 * PI / (1000 * strRate);
@@ -94,6 +129,9 @@ int main (int argc, char *argv[])
     nTimeSteps = steps_per_oscillation * num_osc;
     frame_sep = steps_per_oscillation / out_per_oscillation;
 
+    if (nonaff_steps <= 0)
+        nonaff_steps = frame_sep;
+
 #ifdef DEBUG
     printf("Time step for simulation: %.3g\n"
            "Steps per oscillation:    %.3g\n"
@@ -118,6 +156,7 @@ int main (int argc, char *argv[])
     std::string stressFilePath = root_path + "/" + stressFileName + extension;
     std::string energyFilePath = root_path + "/" + energyFileName + extension;
     std::string nonaffFilePath = root_path + "/" + nonaffFileName + extension;
+    std::string renderFilePath = root_path + "/" + renderFileName;
 
 #ifdef DEBUG
     printf("Output path: %s\n"
@@ -129,34 +168,85 @@ int main (int argc, char *argv[])
 
     // Initialize PRNG.
 
-    if (prngseed == 0)
-    {
-        unsigned int seed = (unsigned int) time(NULL);
-#ifdef DEBUG
-        printf("Random seed: %d\n", seed);
-#endif
-        srand( seed );
-    } else
-    {
+    unsigned int seed = prngseed == 0 ? (unsigned int) time(NULL) : prngseed;
 #ifdef DEBUG
-        printf("Random seed: %d\n", prngseed);
+    printf("Random seed: %d\n", seed);
 #endif
-        srand( prngseed );
-    }
+    srand( seed );
+
+    // The strain protocol gives the shear rate of each step (see protocol.h).
+    // If the strain magnitude is gamma * network_height, the actual strain on
+    // the network is 2 * gamma. Therefore, we halve gamma so that requesting
+    // a simulation with a certain strain results in the network with that
+    // strain and not double that strain. Under stress control the protocol
+    // is the target stress instead.
+
+    bool controlStress = myOptions.control == "stress";
+    double scale = controlStress ? 1.0 : 1 / 2.0;
+
+    Protocol protocol(Protocol::parseKind(myOptions.protocol),
+            (controlStress ? myOptions.stress : initStrain) * scale, strRate,
+            TIMESTEP, (controlStress ? myOptions.laos_stress : myOptions.laos_strain)
+            * scale, num_osc);
+
+    if (protocol.kind == Protocol::table
+            && protocol.load(myOptions.protocolTable, scale))
+        return 1;
+
+    // A network of arbitrary topology is integrated by graph.cpp.
+
+    if (!myOptions.graphFileName.empty())
+        return integrateGraph(myOptions, nTimeSteps, protocol, root_path);
+
+    // In replica mode, several copies of the network are integrated together
+    // instead (see replicas.h).
+
+    if (myOptions.replicas != 0)
+        return integrateReplicas(myOptions, seed, nTimeSteps, protocol,
+                root_path, nonaff_steps);
 
     // Now that those are parsed, we can start to generate our network.
 
-    double *position = new double [2 * netSize * netSize];
-    double *delta = new double [2 * netSize * netSize];
-    double *stress_array = new double [nTimeSteps];
     double ***sprstiff = new double **[netSize];
     double ***netForces = new double **[netSize];
 
     for (int i = 0; i < netSize; i++)
     {
         sprstiff[i] = new double *[netSize];
-        netForces[i] = new double *[netSize];
 
+        for (int j = 0; j < netSize; j++)
+            sprstiff[i][j] = stiffVecGen(pBond, 3);
+    }
+
+    // In linear-response mode, G*(w) is solved for directly instead (see
+    // response.h).
+
+    if (!myOptions.response.empty())
+        return linearResponse(myOptions, sprstiff, root_path);
+
+    // With --autotune, the number of processes and the step kernel are those
+    // that integrate these springs fastest on this machine (see tune.h).
+    // tile is the number of rows per tile of Network::step, or 0 if the
+    // separate kernels are used.
+
+    int tile = 0;
+
+    if (myOptions.autotune != 0)
+    {
+        Tuning tuning = autotune(sprstiff, protocol, nTimeSteps, temp,
+                motors != 0, myOptions.autotune_budget, myOptions.autotune_cache);
+        procs = tuning.procs;
+        tile = tuning.tile;
+    }
+
+    // The positions and deltas are shared with the worker processes, if any.
+
+    Domain myDomain(procs);
+    double *position = myDomain.allocate(2 * netSize * netSize);
+    double *delta = myDomain.allocate(2 * netSize * netSize);
+
+    for (int i = 0; i < netSize; i++)
+    {
         for (int j = 0; j < netSize; j++)
         {
             // x-coordinate
@@ -164,37 +254,90 @@ int main (int argc, char *argv[])
 
             // y-coordinate
             position[(i * netSize + j) * 2 + 1] = sqrt(3) / 2 * RESTLEN * i;
+        }
+    }
 
-            sprstiff[i][j] = stiffVecGen(pBond, 3);
+    // Start the worker processes. Every process has the same springs, since
+    // they were drawn before the fork, but each needs its own thermal noise.
+
+    int rank = myDomain.launch();
+
+    if (procs > 1)
+        srand( seed + rank );
+
+    TIMER_NODES((myDomain.iEnd - myDomain.iBegin) * (double) netSize);
+
+    // Forces are only needed for the rows this process owns and its ghost row.
+
+    for (int i = 0; i < netSize; i++)
+    {
+        netForces[i] = NULL;
+
+        if (!myDomain.needsRow(i))
+            continue;
+
+        netForces[i] = new double *[netSize];
+
+        for (int j = 0; j < netSize; j++)
             netForces[i][j] = new double[6];
-        }
     }
 
 #ifdef DEBUG
-    printf("position, delta, stress_array, sprstiff, and netForces are all"
+    printf("position, delta, sprstiff, and netForces are all"
            " allocated.\n");
 #endif
 
-    // If the strain magnitude is gamma * network_height, the actual strain on
-    // the network is 2 * gamma. Therefore, we halve gamma before making the
-    // strain array so that requesting a simulation with a certain strain
-    // results in the network with that strain and not double that strain.
+    Network myNetwork(position, delta, sprstiff, netForces);
+    myNetwork.setRows(myDomain.iBegin, myDomain.iEnd);
 
-    initStrain *= 1 / 2.0;
-    double* strain_array = new double[nTimeSteps];
-    double* strain_rate = new double[nTimeSteps];
+    if (myOptions.hydro != 0)
+        myNetwork.hydro = new Hydro(netSize * netSize, myNetwork.boundary);
 
-    for (int i = 0; i < nTimeSteps; i++)
+    Printer myPrinter(myNetwork, pBond, nTimeSteps, frame_sep);
+    myPrinter.setPrecision(precision);
+    Motors myMotors(sprstiff);
+
+    // Only the first process writes output. The files stay open for the
+    // whole run and are flushed at every frame.
+
+    if (rank == 0)
     {
-        strain_rate[i]  = initStrain * strRate * cos(strRate * i * TIMESTEP);
+      if (print_array[1])
+        myPrinter.openNonAff(nonaffFilePath);
+      if (print_array[2])
+        myPrinter.openStress(stressFilePath);
+      if (print_array[3])
+        myPrinter.openEnergy(energyFilePath);
     }
 
-    Network myNetwork(position, delta, sprstiff, netForces);
-    Printer myPrinter(myNetwork, pBond, nTimeSteps, frame_sep);
-    Motors myMotors(sprstiff);
+    // Frames are rendered on a background thread of the first process.
+
+    Renderer *myRenderer = NULL;
+
+    if (rank == 0 && renderFileName.compare(""))
+      myRenderer = new Renderer(myNetwork, render_width, render_colors,
+              renderFilePath, render_stream != 0);
+
+    // The first process also publishes its progress for integrator-top at
+    // every frame (see status.h).
+
+    Telemetry *telemetry = NULL;
+    double lastNonAff = 0.0, lastNonAffdd = 0.0;
+
+    if (rank == 0)
+      telemetry = new Telemetry(myOptions.status_dir, root_path, nTimeSteps, frame_sep);
+
+    // ... and, if asked to, every frame for programs following the run (see
+    // frames.h).
+
+    FrameRing *frameRing = NULL;
+
+    if (rank == 0 && !myOptions.frameRingFileName.empty())
+      frameRing = new FrameRing(myOptions.frameRingFileName, myOptions.frame_slots,
+              root_path, frame_sep);
 
 #ifdef DEBUG
-    printf("myNetwork, myPrinter, myMotors, strain_array, and strain_rate all"
+    printf("myNetwork, myPrinter, and myMotors all"
            " allocated.\n");
 #endif
 
@@ -206,33 +349,150 @@ int main (int argc, char *argv[])
     // is only one real term of interest, because σ_xy = σ_yx. This is the
     // number that is output by calcStress.
 
+    // The health monitor saves the state every health_steps steps, and rolls
+    // back to it when the network blows up (see health.h).
+
+    // Under stress control, the shear rate of each step is set by the stress
+    // of the step before.
+
+    StressControl stressControl(protocol, myOptions.control_gain,
+            myOptions.control_integral);
+    StressControl *control = controlStress ? &stressControl : NULL;
+
+    Health health(myNetwork, motors != 0 ? &myMotors : NULL, control,
+            myOptions.health_steps, myOptions.health_depth, myOptions.max_step,
+            myDomain.iBegin, myDomain.iEnd);
+
     for (int i = 0; i < nTimeSteps; i++) {
-        strain_array[i] = affdel * 2 / (sqrt(3.0) / 2.0 * netSize);;
-        // Calculate the net forces in the network.
 
-        if (motors != 0)
-            myNetwork.getNetForces(myMotors);
+        char failure[128] = "";
+        double stress = 0.0;
+        double rate = control != NULL ? control->rate : protocol.rate(i);
+
+        if (health.due(i))
+        {
+            double worst = myDomain.reduceMax(myNetwork.maxDelta);
+
+            if (health.healthy(worst))
+                health.save(i, rank == 0 ? myPrinter.mark() : Printer::Mark());
+            else
+                snprintf(failure, sizeof(failure), "a node moved by %.3g in one step", worst);
+        }
+
+        strain = affdel * 2 / (sqrt(3.0) / 2.0 * netSize);
+
+        // The fused step does the whole step in one sweep, unless the state
+        // before the nodes are moved has to be written out.
+
+        bool sampled = print_array[1] && i > 0 && i % nonaff_steps == 0;
+        bool fused = tile > 0 && health.substeps == 1 && i % frame_sep != 0 && !sampled;
+
+        if (failure[0] != '\0')
+        {
+            // Nothing more is done in a failed state.
+        }
+        else if (fused)
+        {
+            myNetwork.accumNonAff = print_array[1] && (i + 1) % nonaff_steps == 0;
+
+            TIMER_START(step_phase);
+            stress = myNetwork.step(rate, temp, tile,
+                    motors != 0 ? &myMotors : NULL);
+            TIMER_STOP(step_phase);
+            TIMER_NODE_STEPS(netSize * (double) netSize);
+        }
         else
-            myNetwork.getNetForces();
+        {
+            // Calculate the net forces in the network.
+
+            TIMER_START(force_phase);
+
+            if (motors != 0)
+                myNetwork.getNetForces(myMotors);
+            else
+                myNetwork.getNetForces();
 
-        // Calculate the stress of the network.
+            TIMER_STOP(force_phase);
+
+            // Calculate the stress of the network. Each process only sums over
+            // its own rows, and the row sums are added in the same order
+            // however many processes there are.
+
+            TIMER_START(stress_phase);
+            myNetwork.calcStress(rate);
+            stress = myDomain.reduceRows(myNetwork.rowStress);
+            TIMER_STOP(stress_phase);
+        }
 
-        stress_array[i] = myNetwork.calcStress(strain_rate[i]);
+        // Roll back if the stress is NaN or the check failed, or quit if
+        // there is nothing left to roll back to.
 
-        // Quit if stress_array[i] is nan.
+        if (failure[0] == '\0' && stress != stress)
+            snprintf(failure, sizeof(failure), "the stress has gone to NaN");
 
-        if (stress_array[i] != stress_array[i])
+        if (failure[0] != '\0')
         {
-            printf("Stress has gone to NaN.\n");
-            printf("p = %.2g, w = %.4g, N = %d, e = %.2g\n", pBond, strRate, netSize, initStrain);
-            myPrinter.printStress(stressFilePath.c_str(), stress_array, strain_array);
-            return 2;
+            int resume = health.rollback(i, failure);
+
+            if (resume < 0)
+            {
+                if (rank == 0)
+                {
+                    printf("p = %.2g, w = %.4g, N = %d, e = %.2g\n", pBond, strRate, netSize, initStrain);
+                    myPrinter.close();
+                    delete myRenderer;
+                    delete telemetry;
+                    delete frameRing;
+
+                    // The phase times up to the failure still tell where the
+                    // run spent its time.
+                    TIMER_SUMMARY();
+                }
+                return myDomain.join(2);
+            }
+
+            if (rank == 0)
+                myPrinter.rewind(health.mark());
+
+            // Publish the restored rows before the forces are computed.
+
+            myDomain.exchange();
+            i = resume - 1;
+            continue;
         }
 
-        // If a filename is specified, print the positions of the nodes.
+        if (fused)
+        {
+            if (control != NULL)
+                control->update(i, stress);
+            continue;
+        }
 
-        if (i % frame_sep == 0)
+        // The nonaffinity of the network was accumulated while the nodes
+        // were last moved, so it can be sampled at every step.
+
+        if (sampled)
         {
+          double nonaff = myDomain.reduceRows(myNetwork.rowNonAff);
+          double nonaffdd = myDomain.reduceRows(myNetwork.rowNonAffdd);
+
+          if (rank == 0)
+          {
+            TIMER_START(output_phase);
+            lastNonAff = nonaff;
+            lastNonAffdd = nonaffdd;
+            myPrinter.printNonAff(i, control != NULL ? control->lastRate
+                    : protocol.rate(i - 1), nonaff, nonaffdd);
+            TIMER_STOP(output_phase);
+          }
+        }
+
+        // If a filename is specified, print the positions of the nodes. The
+        // other processes wait until the frame is written before moving on.
+
+        if (i % frame_sep == 0 && rank == 0)
+        {
+          TIMER_START(output_phase);
           std::cout << "/" << std::flush;
           if (print_array[0]) { // Position data
             int frame = i / frame_sep;
@@ -240,38 +500,102 @@ int main (int argc, char *argv[])
             std::string posFilePath = root_path + posFileName + "_" + iter + extension;
             myPrinter.printPos(posFilePath.c_str());
           }
-          if (print_array[1]) { // Time-varying nonaffinity.
-            myPrinter.printNonAff(nonaffFilePath.c_str(), i, strain_rate[i > 0 ? i - 1 : 0]);
-          }
+          if (myRenderer != NULL)
+            myRenderer->submit(i / frame_sep);
+          myPrinter.printStress(i, stress, strain);
+          telemetry->update(i, affdel, strain, stress,
+                  lastNonAff, lastNonAffdd, health.substeps);
+          if (frameRing != NULL)
+            frameRing->publish(i, affdel, strain, stress, position, delta);
+          myPrinter.flush();
+          TIMER_STOP(output_phase);
+
+          if (timer_frames > 0 && (i / frame_sep) % timer_frames == 0)
+            TIMER_LINE(i);
+        }
+
+        if (i % frame_sep == 0)
+            myDomain.exchange();
+
+        // Simulate the movement for this time step, then exchange the ghost
+        // rows with the neighbouring processes.
+
+        // Only accumulate the nonaffinity when it will be sampled next step.
+        // While the monitor recovers from a failure, the step is split into
+        // substeps, each with its own forces.
+
+        double dt = TIMESTEP;
+        TIMESTEP = dt / health.substeps;
+
+        for (int sub = 0; sub < health.substeps; sub++)
+        {
+            if (sub > 0)
+            {
+                TIMER_START(force_phase);
+
+                if (motors != 0)
+                    myNetwork.getNetForces(myMotors);
+                else
+                    myNetwork.getNetForces();
+
+                TIMER_STOP(force_phase);
+
+                // The neighbours must be done reading our rows as ghosts
+                // before we move them; on the first substep, the reduction
+                // of the stress does this.
+                myDomain.exchange();
+            }
+
+            myNetwork.accumNonAff = print_array[1] && (i + 1) % nonaff_steps == 0
+                && sub == health.substeps - 1;
+
+            TIMER_START(move_phase);
+            myNetwork.moveNodes(rate, temp);
+            TIMER_STOP(move_phase);
+            TIMER_NODE_STEPS((myDomain.iEnd - myDomain.iBegin) * (double) netSize);
+
+            myDomain.exchange();
         }
 
-        // Simulate the movement for this time step.
+        TIMESTEP = dt;
 
-        myNetwork.moveNodes(strain_rate[i], temp);
+        if (control != NULL)
+            control->update(i, stress);
     }
-    printf("\n");
 
     // The boolean variables defined above determine whether or not to print
     // this information.
 
-    if (print_array[2])
+    if (rank == 0)
     {
-      myPrinter.printStress(stressFilePath.c_str(), stress_array, strain_array);
-    }
+      printf("\n");
 
-    if (print_array[3])
-    {
-      myPrinter.printEnergy(energyFilePath.c_str(), myNetwork()); // Energy
+      TIMER_START(output_phase);
+
+      if (print_array[3])
+      {
+        myPrinter.printEnergy(myNetwork()); // Energy
+      }
+
+      myPrinter.close();
+
+      // Wait for the last frames to be rendered.
+      delete myRenderer;
+      delete telemetry;
+      delete frameRing;
+
+      TIMER_STOP(output_phase);
+      TIMER_SUMMARY();
     }
 
     // Cleanup
-    delete[] position;
-    delete[] stress_array;
+    delete myNetwork.hydro;
 
     for (int i = 0; i < netSize; i++) {
         for (int j = 0; j < netSize; j++) {
             delete[] sprstiff[i][j];
-            delete[] netForces[i][j];
+            if (netForces[i])
+                delete[] netForces[i][j];
         }
         delete[] sprstiff[i];
         delete[] netForces[i];
@@ -279,8 +603,6 @@ int main (int argc, char *argv[])
 
     delete[] sprstiff;
     delete[] netForces;
-    delete[] strain_rate;
-    delete[] strain_array;
 
-    return 0;
+    return myDomain.join(0);
 }
@@ -0,0 +1,81 @@
+#ifndef LEESEDWARDS_H_
+#define LEESEDWARDS_H_
+
+// leesedwards.h
+// -------------
+//
+// leesedwards.h defines the struct LeesEdwards, the sheared periodic boundary
+// of the network. The network is periodic in x with period width and in y
+// with period height. The periodic image of the network above the top row is
+// additionally displaced in x by offset, which holds both the half-row shift
+// of the triangular lattice (netSize / 2) and the shear applied so far.
+//
+// Instead of adding the total shear to the positions of the image, offset is
+// kept modulo width, and the vector between two bonded nodes is mapped back
+// to its nearest image in x. This is exact as long as bonds are shorter than
+// half the width of the network, so the boundary stays correct for any total
+// strain. For the same reason the x coordinates of the nodes may be wrapped
+// back into the box (see wrap) without changing any bond vector.
+
+#include <math.h>
+
+extern int netSize;
+
+struct LeesEdwards {
+
+    double width;   // Period of the network in x
+    double height;  // Period of the network in y
+    double offset;  // Shift in x of the image above the top row, in [0, width)
+    double rate;    // Change in offset per unit change in affdel
+
+    LeesEdwards() :
+        width(netSize),
+        height(netSize * sqrt(3.0) / 2.0),
+        offset(netSize / 2.0),
+        rate(2.0 + 2.0 / (netSize - 1.0)) {}
+
+    // advance moves the image above the top row by rate * daffdel, where
+    // daffdel is the change in affdel over the time step.
+    inline void advance(double daffdel) {
+
+        offset += rate * daffdel;
+        offset -= width * floor(offset / width);
+    }
+
+    // dx returns the x component of a bond whose ends are separated by x in
+    // the box and which crosses the top of the network cross times (-1, 0 or
+    // 1), mapped to the nearest periodic image.
+    inline double dx(double x, int cross) const {
+
+        x += cross * offset;
+        return x - width * floor(x / width + 0.5);
+    }
+
+    // dy returns the y component of the same bond.
+    inline double dy(double y, int cross) const {
+
+        return y + cross * height;
+    }
+
+    // image maps a displacement in x (e.g. from the affine position of a
+    // node) to the nearest periodic image.
+    inline double image(double x) const {
+
+        return x - width * floor(x / width + 0.5);
+    }
+
+    // wrap returns the x coordinate x moved back into [-width, 2 * width)
+    // by a whole number of periods. The range is generous so that nodes of
+    // an undeformed network are never wrapped.
+    inline double wrap(double x) const {
+
+        if (x >= 2.0 * width)
+            return x - width;
+        if (x < -width)
+            return x + width;
+        return x;
+    }
+
+};
+
+#endif /* LEESEDWARDS_H_ */
@@ -4,6 +4,7 @@
 // motors.cpp contains the methods relating to force-dipole motor-network
 // interactions in the integrator code.
 
+#include <cstring>
 #include "motors.h"
 
 void Motors::step_motors()
@@ -64,3 +65,13 @@ double Motors::getforce(int i, int j, int k)
 {
     return motortimes[(i * netSize + j) * 3 + k] > 0 ? MOTORFORCE : 0;
 }
+
+void Motors::save(double *state) const
+{
+    memcpy(state, motortimes, 3 * netSize * netSize * sizeof(double));
+}
+
+void Motors::restore(const double *state)
+{
+    memcpy(motortimes, state, 3 * netSize * netSize * sizeof(double));
+}
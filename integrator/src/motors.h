@@ -22,7 +22,9 @@ class Motors
     
     Motors(double*** sspr) : spr(sspr) 
     {
-        motortimes = new double[3 * netSize * netSize];
+        // All motors start unbound and draw their first binding time on the
+        // first step.
+        motortimes = new double[3 * netSize * netSize]();
     }
     
     ~Motors() 
@@ -38,6 +40,11 @@ class Motors
     double generate_unbound_time();
     
     double getforce(int /* row */, int /* col */, int /* spr */);
+
+    // save copies the state of the motors, 3 * netSize * netSize doubles, to
+    // state, and restore sets it back from there.
+    void save(double * /* state */) const;
+    void restore(const double * /* state */);
     
     private:
     double* motortimes;
@@ -5,138 +5,112 @@
 // the force calculator, the stress calculator, and the node mover.
 
 #include "network.h"
+#include "timers.h"
+#include "hydro.h"
+#include "reduce.h"
 #include <iostream>
+#include <vector>
 #include <math.h>
 
-// euclDist is a Euclidean distance calculator that works with the
-// pointer nPtr declared in operator(). It takes into account the periodic
-// boundary condition for the system. This is the function that incorporates
-// strain into the network.
-// 
-// Note that we use jMax + 1 and iMax + 1 in these expressions because they
-// are equivalent to the size of the network netSize. 
+// Network Function Definitions.
+
+// buildNeighborTables handles the periodic boundary once, so the kernels
+// below need no special cases for the edges of the network.
+
+void buildNeighborTables(int *neighbors, signed char *crossings) {
+
+    int iMax = netSize - 1, jMax = netSize - 1;
+
+    for (int i = 0; i <= iMax; i++) {
+
+        for (int j = 0; j <= jMax; j++) {
+
+            int n = i * netSize + j;
 
-double euclDist(const double* pos, const int k) {
+            int j1 = j == jMax ? 0 : j + 1;
+            int i1 = i == iMax ? 0 : i + 1;
+            int j2 = j == 0 ? jMax : j - 1;
 
-    double x = (pos[2 * k] - pos[0]);
-    double y = (pos[2 * k + 1] - pos[1]);
+            neighbors[3 * n] = i * netSize + j1;
+            neighbors[3 * n + 1] = i1 * netSize + j;
+            neighbors[3 * n + 2] = i1 * netSize + j2;
 
-    return sqrt(x * x + y * y);
+            crossings[3 * n] = 0;
+            crossings[3 * n + 1] = i == iMax ? 1 : 0;
+            crossings[3 * n + 2] = i == iMax ? 1 : 0;
+
+        }
+
+    }
 
 }
 
-// deltaLSqrd returns the square change in the length of the spring.
+void Network::buildNeighbors() {
 
-double deltaL(double* pos, const int k) {
+    neighbors = new int[3 * netSize * netSize];
+    crossings = new signed char[3 * netSize * netSize];
 
-    return euclDist(pos, k) - RESTLEN;
+    buildNeighborTables(neighbors, crossings);
 
 }
 
-// Network Function Definitions.
 double Network::operator() () {
 
-    double funcvalue = 0;
+    double *rowEnergy = new double[netSize];
+    double dx, dy;
 
     for(int i = 0; i <= iMax; i++) {
+
+        Neumaier funcvalue;
+
         for (int j = 0; j <= jMax; j++) {
 
-            // Make the array double pos[]. This shall point to the
-            // positions of the following nodes:
-            //
-            // 1. node i, j
-            // 2. node i, j + 1 (j1)
-            // 3. node i + 1 (i1), j
-            // 4. node i + 1, j - 1 (j2)
-            //
-            // Make sure to impose the periodic boundary condition here.
-            // This is done by making a temporary node copy of the
-            // corresponding mode (using modulo arithemetic).
-            //
-            // Strain is obtained by shifting the bonds at the top of the
-            // network over by an integer number of points in the
-            // x-direction. When measuring the energy, it only affects the
-            // topmost row (i = iMax).
-
-            isiMax = i == iMax;
-            isjMax = j == jMax;
-            isjMin = j == 0;
-
-            int j1 = isjMax ? 0 : j + 1;
-            int i1 = isiMax ? 0 : i + 1;
-            int j2 = isjMin ? jMax : j - 1;
-
-            double tempPos[8] = {
-
-                pos[(i * netSize + j) * 2], 
-                pos[(i * netSize + j) * 2 + 1], 
-                pos[(i * netSize + j1) * 2],
-                pos[(i * netSize + j1) * 2 + 1],
-                pos[(i1 * netSize + j) * 2],
-                pos[(i1 * netSize + j) * 2 + 1],
-                pos[(i1 * netSize + j2) * 2],
-                pos[(i1 * netSize + j2) * 2 + 1]
-
-            };
+            int n = i * netSize + j;
 
             for (int k = 1; k < 4; k++) {
 
-                double delta = deltaL(tempPos, k);
-                funcvalue = 0.5 * spring[i][j][k - 1] / RESTLEN * delta * delta;
+                double delta = bond(n, k, dx, dy) - RESTLEN;
+                funcvalue.add(0.5 * spring[i][j][k - 1] / RESTLEN * delta * delta);
 
             }
 
         } // Cycling all columns in a row
-    } // Cycling all rows
 
-    return funcvalue;
+        rowEnergy[i] = funcvalue.value();
 
-}
-
-void Network::getNetForces(Motors motorarray) {
+    } // Cycling all rows
 
-    motorarray.step_motors();
+    double energy = sumRows(rowEnergy, netSize);
+    delete[] rowEnergy;
 
-    for (int i = 0; i <= iMax; i++) {
+    return energy;
 
-        for (int j = 0; j <= jMax; j++) {
+}
 
-            isiMin = i == 0;
-            isiMax = i == iMax;
-            isjMin = j == 0;
-            isjMax = j == jMax;
+// The row kernels below do the work of the kernels for a single row i, so
+// that the separate kernels and the fused step share them.
 
-            int j1 = isjMax ? 0 : j + 1;
-            int i1 = isiMax ? 0 : i + 1;
-            int j2 = isjMin ? jMax : j - 1;
+inline void Network::forceRow(int i, Motors *motorarray) {
 
-            double tempPos[8] = {
+    double x_displacement, y_displacement;
 
-                pos[(i * netSize + j) * 2], 
-                pos[(i * netSize + j) * 2 + 1], 
-                pos[(i * netSize + j1) * 2],
-                pos[(i * netSize + j1) * 2 + 1] ,
-                pos[(i1 * netSize + j) * 2],
-                pos[(i1 * netSize + j) * 2 + 1],
-                pos[(i1 * netSize + j2) * 2],
-                pos[(i1 * netSize + j2) * 2 + 1]
+    for (int j = 0; j <= jMax; j++) {
 
-            };
+        int n = i * netSize + j;
 
-            // Calculate the net x and y force on each node. Similar to gradient function.
+        // Calculate the net x and y force on each node. Similar to gradient function.
 
-            for (int k = 1; k < 4; k++) {
+        for (int k = 1; k < 4; k++) {
 
-                double x_displacement = tempPos[2 * k] + xshift(k) - tempPos[0];
-                double y_displacement = tempPos[2 * k + 1] + yshift(k) - tempPos[1];
+            double dist = bond(n, k, x_displacement, y_displacement);
 
-                double dist = euclDist(tempPos, k);
+            double cosx = x_displacement / dist;
+            double sinx = y_displacement / dist;
 
-                double cosx = x_displacement / dist;
-                double sinx = y_displacement / dist;
+            if (motorarray != NULL) {
 
-                double motorforce = motorarray.getforce(i, j, k);
-                double temp = spring[i][j][k - 1] * deltaL(tempPos, k)
+                double motorforce = motorarray->getforce(i, j, k);
+                double temp = spring[i][j][k - 1] * (dist - RESTLEN)
                     / RESTLEN + motorforce;
 
                 double xcomp = temp * cosx;
@@ -144,6 +118,14 @@ void Network::getNetForces(Motors motorarray) {
                 forces[i][j][2 * k - 2] = xcomp > 1e-10 ? xcomp : 0;
                 forces[i][j][2 * k - 1] = ycomp > 1e-10 ? ycomp : 0;
 
+            } else {
+
+                double temp = spring[i][j][k - 1] * (dist - RESTLEN)
+                    / RESTLEN;
+
+                forces[i][j][2 * k - 2] = temp * cosx;
+                forces[i][j][2 * k - 1] = temp * sinx;
+
             }
 
         }
@@ -152,111 +134,155 @@ void Network::getNetForces(Motors motorarray) {
 
 }
 
-void Network::getNetForces() {
+inline double Network::stressRow(int i) const {
 
-    for (int i = 0; i <= iMax; i++) {
+    Neumaier stress;
+    double xforce, ydist;
 
-        for (int j = 0; j <= jMax; j++) {
+    for (int j = 0; j <= jMax; j++) {
 
-            isiMin = i == 0;
-            isiMax = i == iMax;
-            isjMin = j == 0;
-            isjMax = j == jMax;
+        int n = i * netSize + j;
+        double node = 0.0;
 
-            int j1 = isjMax ? 0 : j + 1;
-            int i1 = isiMax ? 0 : i + 1;
-            int j2 = isjMin ? jMax : j - 1;
+        for (int k = 1; k < 4; k++) {
 
-            double tempPos[8] = {
+            int m = neighbors[3 * n + k - 1];
 
-                pos[(i * netSize + j) * 2], 
-                pos[(i * netSize + j) * 2 + 1], 
-                pos[(i * netSize + j1) * 2] + xshift(1),
-                pos[(i * netSize + j1) * 2 + 1] + yshift(1),
-                pos[(i1 * netSize + j) * 2] + xshift(2),
-                pos[(i1 * netSize + j) * 2 + 1] + yshift(2),
-                pos[(i1 * netSize + j2) * 2] + xshift(3),
-                pos[(i1 * netSize + j2) * 2 + 1] + yshift(3)
+            // Get the x-component of the force.
+            xforce = forces[i][j][2 * k - 2];
 
-            };
+            // Get the y-distance between nodes.
+            ydist = boundary.dy(pos[2 * m + 1] - pos[2 * n + 1],
+                    crossings[3 * n + k - 1]);
 
-            // Calculate the net x and y force on each node. Similar to gradient function.
+            node += xforce * ydist;
 
-            for (int k = 1; k < 4; k++) {
+        }
 
-                double x_displacement = tempPos[2 * k] - tempPos[0];
-                double y_displacement = tempPos[2 * k + 1] - tempPos[1];
+        // Only the sum over the nodes is compensated; the three bonds of a
+        // node are few enough to add directly.
 
-                double dist = euclDist(tempPos, k);
+        stress.add(node);
 
-                double cosx = x_displacement / dist;
-                double sinx = y_displacement / dist;
+    }
 
-                double temp = spring[i][j][k - 1] * deltaL(tempPos, k)
-                    / RESTLEN;
+    return stress.value();
 
-                forces[i][j][2 * k - 2] = temp * cosx;
-                forces[i][j][2 * k - 1] = temp * sinx;
-            }
+}
+
+// moveRow moves the nodes of row i with the boundary moved, i.e. the boundary
+// after it was advanced for this step, and sets rowNonAff[i] and
+// rowNonAffdd[i] to their nonaffinity if accumNonAff is set.
+
+inline void Network::moveRow(int i, double shear_rate, double temp, double sigma,
+        const LeesEdwards &moved, const double *hydroDelta) {
+
+    double netx, nety, affvel, gamma;
+    double worst = 0.0;
+    Neumaier sqrdisp, sqrdispdd;
+
+    // Affine position of node (i, 0), as in affxpos and affypos.
+    double affx = i / 2.0 + affdel * ((2.0 * i) / (netSize - 1.0) - 1.0);
+    double affy = sqrt(3.0) / 2.0 * i;
 
+    for (int j = 0; j <= jMax; j++) {
+
+        int currentx = (i * netSize + j) * 2;
+        int currenty = currentx + 1;
+
+        netForce(i, j, netx, nety);
+
+        affvel = affvx(i, shear_rate);
+        // vel_fluid = sqrt(3.0) / 4.0 * netSize * shear_rate * (2 * ((double) i - netSize) / (netSize + 1) + 1);
+
+        gamma = 4 * PI * ETA * RADIUS;
+
+        if (hydroDelta != NULL)
+        {
+            delta[currentx] = hydroDelta[currentx] + TIMESTEP * affvel;
+            delta[currenty] = hydroDelta[currenty];
+            pos[currentx] += delta[currentx];
+            pos[currenty] += delta[currenty];
+        }
+        else if (temp > 1e-15)
+        {
+            double theta = 2 * PI * randDouble(0, 1);
+            double r = sigma * sqrt(-2 * log(randDouble(0, 1)));
+
+            double temp_fluct_x = r * cos(theta);
+            double temp_fluct_y = r * sin(theta);
+
+            delta[currentx] = TIMESTEP * (netx / gamma + affvel) + temp_fluct_x;
+            delta[currenty] = TIMESTEP * (nety / gamma) + temp_fluct_y;
+            pos[currentx] += delta[currentx];
+            pos[currenty] += delta[currenty];
+        } else // temp = 0.0
+        {
+            delta[currentx] = TIMESTEP * (netx / gamma + affvel);
+            delta[currenty] = TIMESTEP * (nety / gamma);
+            pos[currentx] += delta[currentx];
+            pos[currenty] += delta[currenty];
         }
 
-    }
+        // Keep steadily sheared nodes from drifting arbitrarily far from
+        // the box, where they would lose precision.
 
-}
+        pos[currentx] = moved.wrap(pos[currentx]);
 
-double Network::calcStress(double strain_rate) {
+        if (accumNonAff)
+        {
+            double dx = moved.image(pos[currentx] - (j + affx));
+            double dy = pos[currenty] - affy;
+            double dvx = delta[currentx] / TIMESTEP - affvel;
+            double dvy = delta[currenty] / TIMESTEP;
 
-    double stress = 0.0;
-    double prefactor = 1 / (sqrt(3.0) / 2.0 * netSize * netSize);
-    double xforce, ydist;
+            sqrdisp.add(dx * dx + dy * dy);
+            sqrdispdd.add(dvx * dvx + dvy * dvy);
+        }
 
-    for (int i = 0; i <= iMax; i++) {
+        worst = nanMax(worst, std::abs(delta[currentx] - TIMESTEP * affvel));
+        worst = nanMax(worst, std::abs(delta[currenty]));
 
-        for (int j = 0; j <= jMax; j++) {
+    }
 
-            isiMax = i == iMax;
-            isjMin = j == 0;
-            isjMax = j == jMax;
+    maxDelta = nanMax(maxDelta, worst);
 
-            int j1 = isjMax ? 0 : j + 1;
-            int i1 = isiMax ? 0 : i + 1;
-            int j2 = isjMin ? jMax : j - 1;
+    if (accumNonAff)
+    {
+        rowNonAff[i] = sqrdisp.value();
+        rowNonAffdd[i] = sqrdispdd.value();
+    }
 
-            double tempPos[8] = {
+}
 
-                pos[(i * netSize + j) * 2],
-                pos[(i * netSize + j) * 2 + 1],
-                pos[(i * netSize + j1) * 2],
-                pos[(i * netSize + j1) * 2 + 1],
-                pos[(i1 * netSize + j) * 2],
-                pos[(i1 * netSize + j) * 2 + 1],
-                pos[(i1 * netSize + j2) * 2],
-                pos[(i1 * netSize + j2) * 2 + 1]
+void Network::getNetForces(Motors motorarray) {
 
-            };
+    TIMER_START(motor_phase);
+    motorarray.step_motors();
+    TIMER_STOP(motor_phase);
 
-            for (int k = 1; k < 4; k++) {
+    for (int row = iBegin - iGhost; row < iEnd; row++)
+        forceRow(row < 0 ? row + netSize : row, &motorarray);
 
-                // Get the x-component of the force.
-                xforce = forces[i][j][2 * k - 2];
+}
 
-                // Get the y-distance between nodes.
-                ydist = tempPos[2 * k + 1] + yshift(k) - tempPos[1];
+void Network::getNetForces() {
 
-                stress += xforce * ydist;
+    for (int row = iBegin - iGhost; row < iEnd; row++)
+        forceRow(row < 0 ? row + netSize : row, NULL);
 
-            }
+}
 
-        }
+double Network::calcStress(double strain_rate) {
 
-    }
+    double prefactor = 1 / (sqrt(3.0) / 2.0 * netSize * netSize);
 
     // Add in viscous network deformation strain.
 
-    stress = stress * prefactor; //  + ETA * strain_rate;
+    for (int i = iBegin; i < iEnd; i++)
+        rowStress[i] = stressRow(i) * prefactor; //  + ETA * strain_rate;
 
-    return stress;
+    return sumRows(rowStress + iBegin, iEnd - iBegin);
 
 }
 
@@ -269,186 +295,129 @@ double affvx(int r, double s_rate)
 
 void Network::moveNodes(double shear_rate, double temp) {
 
-    double netx, nety, affvel, gamma;
+    if (hydro != NULL) {
+        moveNodesHydro(shear_rate, temp);
+        return;
+    }
+
     double d = KB * temp / (6 * PI * ETA * RADIUS);
     double sigma = sqrt(2 * d * TIMESTEP);
 
-    affvel = affvx(netSize - 1, shear_rate);
+    double affvel = affvx(netSize - 1, shear_rate);
     affdel += affvel * TIMESTEP;
+    boundary.advance(affvel * TIMESTEP);
 
-    for (int i = 0; i <= iMax; i++) {
+    for (int i = iBegin; i < iEnd; i++)
+        moveRow(i, shear_rate, temp, sigma, boundary, NULL);
 
-        for (int j = 0; j <= jMax; j++) {
-
-            int currentx = (i * netSize + j) * 2;
-            int currenty = currentx + 1;
-
-            isjMax = j == jMax;
-            isiMin = i == 0;
-            isjMin = j == 0;
-
-            int j1 = isjMax ? 0 : j + 1;
-            int i2 = isiMin ? iMax : i - 1;
-            int j2 = isjMin ? jMax : j - 1;
-
-            double fHooke[12] = {
-
-                forces[i][j][0],
-                forces[i][j][1],
-                forces[i][j][2],
-                forces[i][j][3],
-                forces[i][j][4],
-                forces[i][j][5],
-                forces[i][j2][0],
-                forces[i][j2][1],
-                forces[i2][j][2],
-                forces[i2][j][3],
-                forces[i2][j1][4],
-                forces[i2][j1][5]
-
-            };
-
-            netx = fHooke[0] + fHooke[2] + fHooke[4] - fHooke[6] - fHooke[8] - fHooke[10];
-            nety = fHooke[1] + fHooke[3] + fHooke[5] - fHooke[7] - fHooke[9] - fHooke[11];
-
-            affvel = affvx(i, shear_rate);
-            // vel_fluid = sqrt(3.0) / 4.0 * netSize * shear_rate * (2 * ((double) i - netSize) / (netSize + 1) + 1);
-
-            gamma = 4 * PI * ETA * RADIUS;
-
-            if (temp > 1e-15)
-            {
-                double theta = 2 * PI * randDouble(0, 1);
-                double r = sigma * sqrt(-2 * log(randDouble(0, 1)));
-
-                double temp_fluct_x = r * cos(theta);
-                double temp_fluct_y = r * sin(theta);
-
-                delta[currentx] = TIMESTEP * (netx / gamma + affvel) + temp_fluct_x;
-                delta[currenty] = TIMESTEP * (nety / gamma) + temp_fluct_y;
-                pos[currentx] += delta[currentx];
-                pos[currenty] += delta[currenty];
-            } else // temp = 0.0
-            {
-                delta[currentx] = TIMESTEP * (netx / gamma + affvel);
-                delta[currenty] = TIMESTEP * (nety / gamma);
-                pos[currentx] += delta[currentx];
-                pos[currenty] += delta[currenty];
-            }
-
-            if (pos[currentx] != pos[currentx] || pos[currenty] != pos[currenty])
-            {
-                throw("NaN value assigned");
-            }
-
-        }
-
-    }
+    sumNonAff();
 
 }
 
-double Network::xshift(const int &k) {
-
-    double xshift = 0.0;
-    double netwidth = netSize;
-    double d = affdel; // delta for the entire network
-    double netshift = netSize / 2.0 + (2.0 + 2.0 / (netSize - 1.0)) * d;
+void Network::sumNonAff() {
 
-    switch (k) {
+    if (!accumNonAff) {
+        nonAff = nonAffdd = 0.0;
+        return;
+    }
 
-        // Case where nPtr[1] is in column 0.
-        case 1: 
-            if (isjMax)
+    // nonAffinity is defined to be zero for the undeformed network.
 
-                xshift += netwidth;
+    if (std::abs(affdel) < 1E-15)
+        for (int i = iBegin; i < iEnd; i++)
+            rowNonAff[i] = 0.0;
 
-            break;
+    nonAff = sumRows(rowNonAff + iBegin, iEnd - iBegin);
+    nonAffdd = sumRows(rowNonAffdd + iBegin, iEnd - iBegin);
 
-        // Case where nPtr[2] is in row 0.
-        case 2: 
-            if (isiMax) {
+}
 
-                xshift += netshift;
+// moveNodesHydro is moveNodes with hydrodynamic interactions: the whole
+// network moves at once, since the velocity of every node depends on the
+// forces on all the others.
 
-            }
-            break;
+void Network::moveNodesHydro(double shear_rate, double temp) {
 
-        // Case where nPtr[3] is in row 0 and/or column jMax.
-        case 3:
-            if (isiMax) {
+    int size = 2 * netSize * netSize;
+    std::vector<double> force(size), hydroDelta(size, 0.0);
 
-                xshift += netshift;
+    for (int i = 0; i <= iMax; i++)
+        for (int j = 0; j <= jMax; j++)
+            netForce(i, j, force[(i * netSize + j) * 2], force[(i * netSize + j) * 2 + 1]);
 
-            }
-            if (isjMin)
+    // The mobility is that of the positions and the boundary before the
+    // step, and so is the drift kT div M of the Brownian motion.
 
-                xshift -= netwidth;
+    hydro->setPositions(pos, boundary);
+    hydro->apply(&force[0], &hydroDelta[0]);
 
-            break;
+    if (temp > 1e-15)
+        hydro->drift(KB * temp, &hydroDelta[0]);
 
-        // Case where nPtr[4] is in column jMax.
-        case 4:
-            if (isjMin) {
+    for (int k = 0; k < size; k++)
+        hydroDelta[k] *= TIMESTEP;
 
-                xshift -= netSize;
+    if (temp > 1e-15)
+        hydro->noise(sqrt(2 * KB * temp * TIMESTEP), &hydroDelta[0]);
 
-            }
-            break;
+    double affvel = affvx(netSize - 1, shear_rate);
+    affdel += affvel * TIMESTEP;
+    boundary.advance(affvel * TIMESTEP);
 
-        // Case where nPtr[5] is in row iMax.
-        case 5: 
-            if (isiMin) {
+    for (int i = 0; i <= iMax; i++)
+        moveRow(i, shear_rate, temp, 0.0, boundary, &hydroDelta[0]);
 
-                xshift -= netshift;
+    sumNonAff();
 
-            }
-            break;
+}
 
-        // Case where nPtr[6] is in row iMax and/or column 0.
-        case 6:
-            if (isiMin) {
+double Network::step(double shear_rate, double temp, int tile, Motors *motorarray) {
 
-                xshift -= netshift;
+    if (motorarray != NULL)
+        motorarray->step_motors();
 
-            }
-            if (isjMax)
+    double d = KB * temp / (6 * PI * ETA * RADIUS);
+    double sigma = sqrt(2 * d * TIMESTEP);
+    double prefactor = 1 / (sqrt(3.0) / 2.0 * netSize * netSize);
 
-                xshift += netwidth;
+    // The forces of the top row are needed to move row 0, and they depend on
+    // the positions of row 0, so they come first.
 
-            break;
-    }
+    forceRow(iMax, motorarray);
+    rowStress[iMax] = stressRow(iMax) * prefactor;
 
-    return xshift;
-}
+    // The forces and the stress see the boundary before the step, and the
+    // moves the boundary after it (affdel is only used by the moves).
 
-double Network::yshift(const int &k) {
+    double affvel = affvx(netSize - 1, shear_rate);
+    affdel += affvel * TIMESTEP;
+    LeesEdwards moved = boundary;
+    moved.advance(affvel * TIMESTEP);
 
-    double yshift = 0.0;
+    for (int begin = 0; begin < iMax; begin += tile) {
 
-    switch (k) {
+        int end = begin + tile < iMax ? begin + tile : iMax;
 
-        case 2: 
-        case 3:
-            if (isiMax) {
+        // Without motors, forceRow is inlined without its motor branch.
 
-                yshift += netSize * sqrt(3.0) / 2.0;
+        for (int i = begin; i < end; i++) {
+            if (motorarray != NULL)
+                forceRow(i, motorarray);
+            else
+                forceRow(i, NULL);
+            rowStress[i] = stressRow(i) * prefactor;
+        }
 
-            }
-            break;
+        for (int i = begin; i < end; i++)
+            moveRow(i, shear_rate, temp, sigma, moved, NULL);
 
-        // Case where nPtr[5] is in row iMax.
-        case 5: 
-        case 6:
-            if (isiMin) {
+    }
 
-                yshift -= netSize * sqrt(3.0) / 2.0;
+    moveRow(iMax, shear_rate, temp, sigma, moved, NULL);
+    boundary = moved;
 
-            }
-            break;
+    sumNonAff();
 
-        default: 
-            break;
-    }
+    return sumRows(rowStress, netSize);
 
-    return yshift;
 }
@@ -10,6 +10,9 @@
 #include <math.h>
 #include "utils.h"
 #include "motors.h"
+#include "leesedwards.h"
+
+struct Hydro;
 
 extern double TIMESTEP;
 extern const double RESTLEN;
@@ -23,6 +26,13 @@ extern double affdel;
 static const double KB = 1;
 static const double PI = 3.1415926535;
 
+// buildNeighborTables fills in the neighbor and crossing tables described in
+// Network for a network of netSize by netSize nodes.
+void buildNeighborTables(int *neighbors, signed char *crossings);
+
+// affvx returns the affine velocity in x of row r at the given shear rate.
+double affvx(int r, double s_rate);
+
 struct Network {
 
     double *pos;
@@ -32,17 +42,85 @@ struct Network {
 
     int iMax, jMax;
 
+    // The force, stress and move kernels only visit the rows [iBegin, iEnd).
+    // When these do not cover the whole network, the forces of the ghost row
+    // iBegin - 1 are computed as well, since moveNodes needs them for row
+    // iBegin.
+    int iBegin, iEnd, iGhost;
+
     bool isiMax, isjMax, isiMin, isjMin;
 
+    // The sheared periodic boundary of the network.
+    LeesEdwards boundary;
+
+    // neighbors[3 * n + k - 1] is the index of the node bonded to node n by
+    // its k-th spring, i.e. the nodes (i, j+1), (i+1, j) and (i+1, j-1).
+    // crossings holds -1, 0 or 1 for the same bonds: the number of times the
+    // bond crosses the top of the network.
+    int *neighbors;
+    signed char *crossings;
+
+    // If accumNonAff is set, moveNodes also sums up the two nonaffinity
+    // measures of nonaffinity.cpp, nonAffinity and nonAffinity_dd, over the
+    // rows it moves. nonAff and nonAffdd then hold the values for the
+    // positions and deltas of the last step, without another pass over the
+    // network.
+    bool accumNonAff;
+    double nonAff, nonAffdd;
+
+    // The sums of each row behind the stress and the nonaffinity (see
+    // reduce.h), [netSize]. Only the rows of the kernels are set, and
+    // Domain::reduceRows adds those of all processes.
+    double *rowStress;
+    double *rowNonAff, *rowNonAffdd;
+
+    // The largest nonaffine displacement in x or y of a node in one step
+    // since maxDelta was last reset, over the rows moved, or NaN once any
+    // node has moved by NaN (see health.h).
+    double maxDelta;
+
+    // If hydro is set, moveNodes couples the nodes through the solvent (see
+    // hydro.h) instead of moving each with its own drag. It needs the whole
+    // network, so it cannot be used with more than one process or with step.
+    Hydro *hydro;
+
     Network(double *ppos, double *ddelta, double ***sspring, double ***fforces) :
         pos(ppos),
         delta(ddelta),
         spring(sspring),
         forces(fforces),
-        isiMax(false), isjMax(false), isiMin(true), isjMin(true) {
+        isiMax(false), isjMax(false), isiMin(true), isjMin(true),
+        accumNonAff(false), nonAff(0.0), nonAffdd(0.0),
+        maxDelta(0.0),
+        hydro(NULL) {
 
         iMax = netSize - 1;
         jMax = netSize - 1;
+
+        rowStress = new double[netSize]();
+        rowNonAff = new double[netSize]();
+        rowNonAffdd = new double[netSize]();
+
+        setRows(0, netSize);
+        buildNeighbors();
+    }
+
+    ~Network() {
+
+        delete[] neighbors;
+        delete[] crossings;
+        delete[] rowStress;
+        delete[] rowNonAff;
+        delete[] rowNonAffdd;
+    }
+
+    // setRows restricts the kernels to the rows [begin, end), e.g. to the
+    // strip owned by this process in a domain decomposition.
+    void setRows(int begin, int end) {
+
+        iBegin = begin;
+        iEnd = end;
+        iGhost = end - begin < netSize ? 1 : 0;
     }
 
     double operator() ();
@@ -64,16 +142,62 @@ struct Network {
     void getNetForces(Motors /* Motors object */);
     void getNetForces();
 
+    // calcStress sets rowStress for the rows of the kernels and returns
+    // their sum.
     double calcStress(double strain_rate);
 
     void moveNodes(double shear_rate, double temp);
 
+    // step does the work of getNetForces, calcStress and moveNodes in one
+    // sweep over the network, tile rows at a time: the forces and stress of
+    // a tile are computed, then its nodes are moved while they are still in
+    // the cache. It returns the stress, and motorarray may be NULL. The sums
+    // are those of calcStress and moveNodes, so the results don't depend on
+    // the tile. step needs the whole network, so it cannot be used with more
+    // than one process.
+    double step(double shear_rate, double temp, int tile, Motors *motorarray);
+
+    // bond sets (dx, dy) to the vector from node n to the node bonded to it
+    // by its k-th spring (k = 1, 2, 3), and returns the length of the bond.
+    inline double bond(int n, int k, double &dx, double &dy) const {
+
+        int m = neighbors[3 * n + k - 1];
+        int cross = crossings[3 * n + k - 1];
+
+        dx = boundary.dx(pos[2 * m] - pos[2 * n], cross);
+        dy = boundary.dy(pos[2 * m + 1] - pos[2 * n + 1], cross);
+
+        return sqrt(dx * dx + dy * dy);
+    }
+
     private:
 
+    void buildNeighbors();
+
+    // Row kernels of the above for row i (see network.cpp).
+    inline void forceRow(int i, Motors *motorarray);
+    inline double stressRow(int i) const;
+    inline void moveRow(int i, double shear_rate, double temp, double sigma,
+            const LeesEdwards &moved, const double *hydroDelta);
+
+    void moveNodesHydro(double shear_rate, double temp);
 
-    double xshift(const int &k);
+    // sumNonAff sets nonAff and nonAffdd from the rows of the kernels.
+    void sumNonAff();
 
-    double yshift(const int &k);
+    // netForce sets (netx, nety) to the net force of the springs on node
+    // (i, j), from the forces array.
+    inline void netForce(int i, int j, double &netx, double &nety) const {
+
+        int j1 = j == jMax ? 0 : j + 1;
+        int i2 = i == 0 ? iMax : i - 1;
+        int j2 = j == 0 ? jMax : j - 1;
+
+        netx = forces[i][j][0] + forces[i][j][2] + forces[i][j][4]
+            - forces[i][j2][0] - forces[i2][j][2] - forces[i2][j1][4];
+        nety = forces[i][j][1] + forces[i][j][3] + forces[i][j][5]
+            - forces[i][j2][1] - forces[i2][j][3] - forces[i2][j1][5];
+    }
 
 };
 
@@ -21,6 +21,7 @@
 #include <cstring>
 
 #include "nonaffinity.h"
+#include "leesedwards.h"
 
 double affxpos(int r, int c)
 {
@@ -35,6 +36,7 @@ double affypos(int r)
 double nonAffinity(double *position)
 {
   double xval, yval, currentx, currenty, prefactor, sqrdisp = 0, nonaffinity = 0;
+  LeesEdwards boundary;
 
   if (std::abs(affdel) < 1E-15)
   {
@@ -51,8 +53,10 @@ double nonAffinity(double *position)
       xval = affxpos(row, col);
       yval = affypos(row);
 
-      double temp = (currentx - xval) * (currentx - xval) + (currenty - yval)
-        * (currenty - yval);
+      // The node may have been wrapped back into the box.
+      double dx = boundary.image(currentx - xval);
+
+      double temp = dx * dx + (currenty - yval) * (currenty - yval);
       sqrdisp += temp;
     }
   }
@@ -11,6 +11,7 @@
 #include <stdlib.h>
 
 #include "options.h"
+#include "protocol.h"
 
 extern int netSize;
 
@@ -26,6 +27,7 @@ int setup_options(int argc, char *argv[], Options &myOpts)
     int *out_per_oscillation = &(myOpts.out_per_oscillation);
     std::string *job = &(myOpts.job);
     int *motors = &(myOpts.motors);
+    int *procs = &(myOpts.procs);
     std::string *energyFileName = &(myOpts.energyFileName);
     std::string *nonaffFileName = &(myOpts.nonaffFileName);
     std::string *stressFileName = &(myOpts.stressFileName);
@@ -53,10 +55,32 @@ int setup_options(int argc, char *argv[], Options &myOpts)
              "set PRNG seed")
         ("job,j", boost::program_options::value<std::string>(job)->default_value("0"), "set job directory")
         ("motors,m", boost::program_options::value<int>(motors)->default_value(0), "enable motors")
+        ("procs,n", boost::program_options::value<int>(procs)->default_value(1),
+             "split the network between this many processes")
+        ("replicas", boost::program_options::value<int>(&(myOpts.replicas))->default_value(0),
+             "integrate a SIMD width of replicas with seeds prng, prng + 1, ... (1)")
+        ("graph", boost::program_options::value<std::string>(&(myOpts.graphFileName))->default_value(""),
+             "integrate the network of arbitrary topology in this file (see src/graph.h)")
+        ("autotune", boost::program_options::value<int>(&(myOpts.autotune))->default_value(0),
+             "choose the number of processes and the step kernel by timing them (1)")
+        ("autotune-budget", boost::program_options::value<double>(&(myOpts.autotune_budget))->default_value(2.0),
+             "set the seconds spent timing configurations for --autotune")
+        ("hydro", boost::program_options::value<int>(&(myOpts.hydro))->default_value(0),
+             "couple the nodes by hydrodynamic interactions (1, see src/hydro.h)")
+        ("health-steps", boost::program_options::value<int>(&(myOpts.health_steps))->default_value(100),
+             "check the network and save its state every this many steps (0 to stop at the first failure)")
+        ("health-depth", boost::program_options::value<int>(&(myOpts.health_depth))->default_value(3),
+             "keep this many saved states to roll back to (see src/health.h)")
+        ("max-step", boost::program_options::value<double>(&(myOpts.max_step))->default_value(0.5),
+             "roll back when a node moves further than this in one step, apart from the shear")
+        ("response", boost::program_options::value<std::vector<double> >(&(myOpts.response))->multitoken(),
+             "solve for G', G'' at these frequencies instead of integrating (see src/response.h)")
         ;
 
     boost::program_options::options_description filename("Filename options");
     filename.add_options()
+        ("output", boost::program_options::value<std::string>(&output_path)->default_value(""),
+             "set output path")
         ("en-fn", boost::program_options::value<std::string>(energyFileName)->default_value(""),
              "set energy data file name")
         ("aff-fn", boost::program_options::value<std::string>(nonaffFileName)->default_value(""),
@@ -65,23 +89,64 @@ int setup_options(int argc, char *argv[], Options &myOpts)
              "set position data file name")
         ("st-fn", boost::program_options::value<std::string>(stressFileName)->default_value(""),
              "set stress data file name")
+        ("resp-fn", boost::program_options::value<std::string>(&(myOpts.responseFileName))->default_value(""),
+             "set linear response file name")
         ("num-osc", boost::program_options::value<int>(numosc)->default_value(6),
              "set the number of full oscillations")
         ("out-per-osc", boost::program_options::value<int>(out_per_oscillation)->default_value(20),
              "set the number of data points to output per oscillation")
+        ("protocol", boost::program_options::value<std::string>(&(myOpts.protocol))->default_value("sine"),
+             "set the strain protocol: sine, step, ramp, laos or table (see src/protocol.h)")
+        ("laos-strain", boost::program_options::value<double>(&(myOpts.laos_strain))->default_value(1.0),
+             "set the last strain of the laos amplitude sweep")
+        ("protocol-table", boost::program_options::value<std::string>(&(myOpts.protocolTable))->default_value(""),
+             "set the file of times and strains (or stresses) of the table protocol")
+        ("control", boost::program_options::value<std::string>(&(myOpts.control))->default_value("strain"),
+             "control the strain or the stress: the protocol is then the target stress")
+        ("stress", boost::program_options::value<double>(&(myOpts.stress))->default_value(0.001),
+             "set the stress amplitude under stress control")
+        ("laos-stress", boost::program_options::value<double>(&(myOpts.laos_stress))->default_value(0.01),
+             "set the last stress of the laos amplitude sweep under stress control")
+        ("control-gain", boost::program_options::value<double>(&(myOpts.control_gain))->default_value(10.0),
+             "set the shear rate per unit of stress error under stress control")
+        ("control-integral", boost::program_options::value<double>(&(myOpts.control_integral))->default_value(1.0),
+             "set the shear rate per unit of time-integrated stress error")
+        ("aff-steps", boost::program_options::value<int>(&(myOpts.nonaff_steps))->default_value(0),
+             "set the number of steps between nonaffinity samples (0: one per output)")
+        ("precision", boost::program_options::value<int>(&(myOpts.precision))->default_value(6),
+             "set the significant digits of output numbers (0: all that are needed)")
+        ("render-fn", boost::program_options::value<std::string>(&(myOpts.renderFileName))->default_value(""),
+             "set rendered frame file name")
+        ("render-color", boost::program_options::value<std::vector<std::string> >(&(myOpts.render_colors))->multitoken(),
+             "color rendered frames by tension and/or nonaffine (tension)")
+        ("render-width", boost::program_options::value<int>(&(myOpts.render_width))->default_value(800),
+             "set the width of rendered frames in pixels")
+        ("render-stream", boost::program_options::value<int>(&(myOpts.render_stream))->default_value(0),
+             "append all rendered frames to one file per coloring")
+        ("autotune-cache", boost::program_options::value<std::string>(&(myOpts.autotune_cache))->default_value(""),
+             "set the file caching the --autotune choice per host and network size")
+        ("status-dir", boost::program_options::value<std::string>(&(myOpts.status_dir))->default_value("/dev/shm"),
+             "publish the progress in a status file here for integrator-top (\"\": none)")
+        ("frame-ring", boost::program_options::value<std::string>(&(myOpts.frameRingFileName))->default_value(""),
+             "publish every frame in this memory-mapped ring file, e.g. in /dev/shm (see src/frames.h)")
+        ("frame-slots", boost::program_options::value<int>(&(myOpts.frame_slots))->default_value(16),
+             "set the number of frames kept in the frame ring")
         ;
 
-    boost::program_options::options_description config("Configuration");
-    config.add_options()
-        ("output", boost::program_options::value<std::string>(&output_path)->default_value(""),
-                             "set output path")
+    // The timers only exist in builds with -DTIMERS.
+    myOpts.timer_frames = 0;
+#ifdef TIMERS
+    filename.add_options()
+        ("timer-frames", boost::program_options::value<int>(&(myOpts.timer_frames)),
+             "print the phase timers every this many output frames")
         ;
+#endif
 
     boost::program_options::options_description cmdline_options;
     cmdline_options.add(general).add(filename);
 
     boost::program_options::options_description config_file_options;
-    config_file_options.add(filename).add(config);
+    config_file_options.add(filename);
 
     // Make the variables_map object.
     boost::program_options::variables_map vm;
@@ -112,11 +177,156 @@ int setup_options(int argc, char *argv[], Options &myOpts)
         notify(vm);
     }
 
-    // Requires an output_path to be assigned in config file.
+    // Requires an output_path to be assigned in the config file or on the
+    // command line.
 
     if (output_path.empty())
     {
-      std::cout << "You must specify an output path in the config file.\n";
+      std::cout << "You must specify an output path in the config file or with --output.\n";
+      return 1;
+    }
+
+    if (*procs < 1 || *procs > netSize)
+    {
+      std::cout << "The number of processes must be between 1 and the network"
+            << " size.\n";
+      return 1;
+    }
+
+    if (myOpts.precision < 0 || myOpts.precision > 17)
+    {
+      std::cout << "The precision must be between 0 and 17 digits.\n";
+      return 1;
+    }
+
+    if (myOpts.render_colors.empty())
+      myOpts.render_colors.push_back("tension");
+
+    if (myOpts.render_width < 1)
+    {
+      std::cout << "The width of rendered frames must be positive.\n";
+      return 1;
+    }
+
+    if (myOpts.replicas != 0 && (*procs > 1 || *motors != 0))
+    {
+      std::cout << "Replicas cannot be combined with motors or more than one"
+            << " process.\n";
+      return 1;
+    }
+
+    if (!myOpts.graphFileName.empty() && (*procs > 1 || *motors != 0
+                || myOpts.replicas != 0 || myOpts.autotune != 0))
+    {
+      std::cout << "A graph cannot be combined with motors, replicas, autotune"
+            << " or more than one process.\n";
+      return 1;
+    }
+
+    if (myOpts.autotune != 0 && myOpts.replicas != 0)
+    {
+      std::cout << "Autotune cannot be combined with replicas.\n";
+      return 1;
+    }
+
+    if (myOpts.hydro != 0 && (*procs > 1 || myOpts.replicas != 0
+                || !myOpts.graphFileName.empty() || myOpts.autotune != 0))
+    {
+      std::cout << "Hydrodynamic interactions cannot be combined with a graph,"
+            << " replicas, autotune or more than one process.\n";
+      return 1;
+    }
+
+    if (myOpts.health_steps < 0 || myOpts.health_depth < 1 || myOpts.max_step <= 0)
+    {
+      std::cout << "The health checks need health-steps >= 0, health-depth >= 1"
+            << " and max-step > 0.\n";
+      return 1;
+    }
+
+    Protocol::Kind kind = Protocol::parseKind(myOpts.protocol);
+
+    if (kind == Protocol::num_kinds)
+    {
+      std::cout << "Unknown strain protocol " << myOpts.protocol
+            << ". Use sine, step, ramp, laos or table.\n";
+      return 1;
+    }
+
+    bool stressControl = myOpts.control == "stress";
+
+    if (!stressControl && myOpts.control != "strain")
+    {
+      std::cout << "Unknown control " << myOpts.control << ". Use strain or stress.\n";
+      return 1;
+    }
+
+    if (kind == Protocol::laos && (stressControl
+                ? myOpts.stress <= 0 || myOpts.laos_stress <= 0
+                : *initStrain <= 0 || myOpts.laos_strain <= 0))
+    {
+      std::cout << "The laos amplitude sweep needs positive amplitudes.\n";
+      return 1;
+    }
+
+    if (stressControl && (myOpts.replicas != 0 || !myOpts.graphFileName.empty()))
+    {
+      std::cout << "Stress control cannot be combined with replicas or a graph.\n";
+      return 1;
+    }
+
+    if (kind == Protocol::table && myOpts.protocolTable.empty())
+    {
+      std::cout << "The table protocol needs a protocol-table.\n";
+      return 1;
+    }
+
+    if (!myOpts.response.empty())
+    {
+      for (size_t f = 0; f < myOpts.response.size(); f++)
+      {
+        if (myOpts.response[f] <= 0)
+        {
+          std::cout << "The response frequencies must be positive.\n";
+          return 1;
+        }
+      }
+
+      if (*motors != 0 || myOpts.hydro != 0 || myOpts.replicas != 0
+              || !myOpts.graphFileName.empty() || stressControl)
+      {
+        std::cout << "The linear response cannot be combined with motors,"
+              << " hydrodynamic interactions, replicas, a graph or stress control.\n";
+        return 1;
+      }
+    }
+
+    if (!myOpts.frameRingFileName.empty())
+    {
+      if (myOpts.frame_slots < 1)
+      {
+        std::cout << "The frame ring needs at least one slot.\n";
+        return 1;
+      }
+
+      if (myOpts.replicas != 0 || !myOpts.graphFileName.empty()
+              || !myOpts.response.empty())
+      {
+        std::cout << "The frame ring cannot be combined with replicas, a graph"
+              << " or the linear response.\n";
+        return 1;
+      }
+    }
+
+    if (myOpts.autotune != 0 && myOpts.autotune_budget <= 0)
+    {
+      std::cout << "The autotune budget must be positive.\n";
+      return 1;
+    }
+
+    if (*procs > 1 && *motors != 0)
+    {
+      std::cout << "Motors are not supported with more than one process.\n";
       return 1;
     }
 
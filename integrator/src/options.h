@@ -9,6 +9,7 @@
  */
 
 #include <string>
+#include <vector>
 
 class Options
 {
@@ -18,22 +19,53 @@ class Options
         nTimeSteps,  // Number of time steps to simulate (200000)
         out_per_oscillation, // How many times to output per oscillation
         num_osc, // Number of oscillations
-        motors;      // Use motors (1)
+        motors,      // Use motors (1)
+        procs,       // Number of processes sharing the network (1)
+        replicas,    // Integrate Replicas::lanes replicas in lockstep (0)
+        timer_frames, // Frames between lines of timer output (0, never)
+        nonaff_steps, // Steps between nonaffinity samples (0, once per frame)
+        precision,   // Significant digits in output files (6, 0 for all)
+        render_width, // Width of rendered frames in pixels (800)
+        render_stream, // Append all rendered frames to one file (0)
+        autotune,    // Choose procs and the step kernel by timing them (0)
+        hydro,       // Couple the nodes through the solvent (0)
+        health_steps, // Steps between health checks (100, 0 for none)
+        health_depth, // Saved states to roll back to (3)
+        frame_slots; // Frames kept in the frame ring (16)
 
     double pBond,             // Bond probability (0.8)
            strRate,           // Strain rate (1.0 Hz*)
            temp,              // Temperature of the system
            initStrain,        // Magnitude of strain (0.01)
-           test_step; // Maximum time step (0.3 s*) [Constant]
+           test_step, // Maximum time step (0.3 s*) [Constant]
+           autotune_budget, // Seconds spent timing configurations (2)
+           max_step,  // Largest healthy nonaffine step of a node (0.5)
+           laos_strain, // Last strain of a LAOS amplitude sweep (1.0)
+           stress,      // Stress amplitude under stress control (0.001)
+           laos_stress, // Last stress of a LAOS amplitude sweep (0.01)
+           control_gain, // Shear rate per unit stress error (10)
+           control_integral; // Shear rate per unit integrated error (1)
 
     std::string energyFileName, // Energy file name
            posFileName,    // Position file name
            nonaffFileName, // Nonaffinity file name
            stressFileName, // Stress file name
+           renderFileName, // Rendered frame file name
            output_path,    // Output path for simulation
            config_file,    // Name and location of config file
            job,            // Job (only used on della) (0)
+           autotune_cache, // File of cached autotune choices ("", none)
+           status_dir,     // Directory of the status file ("/dev/shm", "" for none)
+           frameRingFileName, // Frame ring file ("", none)
+           graphFileName, // Graph to integrate instead of the lattice ("", none)
+           responseFileName, // Linear response file name
+           protocol,       // Strain protocol (sine, see protocol.h)
+           control,        // Controlled quantity (strain or stress)
+           protocolTable,  // Strain table of the table protocol ("", none)
            extension; // File extension
+
+    std::vector<std::string> render_colors; // Colorings of rendered frames
+    std::vector<double> response; // Frequencies of the linear response (none)
   
 };
 
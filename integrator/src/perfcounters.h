@@ -0,0 +1,141 @@
+#ifndef PERFCOUNTERS_H_
+#define PERFCOUNTERS_H_
+
+// perfcounters.h
+// --------------
+//
+// perfcounters.h reads the hardware performance counters of Linux
+// (perf_event_open) for the process that opens them: cycles, instructions,
+// L1 data cache read misses, last level cache misses and branch misses. The
+// counters are opened as one group, so they count the same stretch of code
+// and one read() returns all of them. If the kernel multiplexes the group
+// with other users of the counters, the values are scaled up by the share of
+// the time the group was counting.
+//
+// The timers of timers.h use these counters per phase in builds with
+// -DPERFCOUNTERS (make PERFCOUNTERS=1), and so does the benchmark of the
+// minimizer (testMiles/source/bench.cpp).
+//
+// A counter the machine doesn't have (e.g. in a virtual machine without a
+// PMU, or with kernel.perf_event_paranoid > 2) reads as NaN and is printed
+// as "-".
+//
+// The hints of bound() are rough. A phase with an IPC of 1.5 or more is
+// taken as compute-bound. Otherwise, if it misses the last level cache more
+// than once per 100 cycles, several misses must be in flight at once and
+// it is bandwidth-bound; if it misses less often it waits on the latency of
+// the caches or of memory.
+
+#include <cstring>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+struct PerfCounters {
+
+    enum {
+        cycles, instructions, l1_misses, llc_misses, branch_misses,
+        num_counters
+    };
+
+    int fd[num_counters];   // -1 for a counter that couldn't be opened
+    int slot[num_counters]; // Place of the counter in a group read
+
+    PerfCounters() : members(0) {
+
+        for (int c = 0; c < num_counters; c++)
+            fd[c] = slot[c] = -1;
+
+        perf_event_attr attr[num_counters];
+        memset(attr, 0, sizeof(attr));
+
+        for (int c = 0; c < num_counters; c++) {
+
+            attr[c].size = sizeof(perf_event_attr);
+            attr[c].type = PERF_TYPE_HARDWARE;
+            attr[c].exclude_kernel = 1;
+            attr[c].exclude_hv = 1;
+            attr[c].read_format = PERF_FORMAT_GROUP
+                | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        }
+
+        attr[cycles].config = PERF_COUNT_HW_CPU_CYCLES;
+        attr[instructions].config = PERF_COUNT_HW_INSTRUCTIONS;
+        attr[l1_misses].type = PERF_TYPE_HW_CACHE;
+        attr[l1_misses].config = PERF_COUNT_HW_CACHE_L1D
+            | PERF_COUNT_HW_CACHE_OP_READ << 8
+            | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+        attr[llc_misses].config = PERF_COUNT_HW_CACHE_MISSES;
+        attr[branch_misses].config = PERF_COUNT_HW_BRANCH_MISSES;
+
+        // The first counter that opens leads the group.
+
+        int leader = -1;
+
+        for (int c = 0; c < num_counters; c++) {
+
+            fd[c] = syscall(__NR_perf_event_open, &attr[c], 0, -1, leader, 0);
+
+            if (fd[c] < 0) {
+                fd[c] = -1;
+                continue;
+            }
+
+            if (leader < 0)
+                leader = fd[c];
+
+            slot[c] = members++;
+        }
+    }
+
+    ~PerfCounters() {
+
+        for (int c = 0; c < num_counters; c++)
+            if (fd[c] >= 0)
+                close(fd[c]);
+    }
+
+    // available is true if any counter could be opened.
+    bool available() const { return members > 0; }
+
+    // read stores the counts since the counters were opened in values, NaN
+    // for those that are missing or were never scheduled.
+    void read(double values[num_counters]) const {
+
+        unsigned long long data[3 + num_counters];
+        bool ok = false;
+
+        for (int c = 0; c < num_counters && !ok; c++)
+            if (fd[c] >= 0)
+                ok = ::read(fd[c], data, sizeof(data)) >= (ssize_t) (3 * sizeof(data[0]));
+
+        // data holds the number of counters, the times enabled and running,
+        // then the counts.
+
+        double scale = ok && data[2] > 0 ? (double) data[1] / data[2] : 0.0;
+
+        for (int c = 0; c < num_counters; c++)
+            values[c] = scale > 0 && slot[c] >= 0 && (unsigned) slot[c] < data[0]
+                ? data[3 + slot[c]] * scale : 0.0 / 0.0;
+    }
+
+    // bound names what limits code that ran for the given cycles and
+    // instructions with llcMisses misses of the last level cache.
+    static const char *bound(double cycles, double instructions, double llcMisses) {
+
+        if (!(cycles > 0) || instructions != instructions)
+            return "-";
+        if (instructions >= 1.5 * cycles)
+            return "compute";
+        if (llcMisses != llcMisses)
+            return "memory";
+        return llcMisses * 100 > cycles ? "bandwidth" : "latency";
+    }
+
+    private:
+
+    int members;
+
+};
+
+#endif /* PERFCOUNTERS_H_ */
@@ -3,8 +3,121 @@
 // print.cpp contains the class Printer to convert a set of ints, doubles and arrays
 // into text files, specifically for integrator.cpp.
 
-#include <boost/lexical_cast.hpp>
+#include <charconv>
+#include <cmath>
+#include <unistd.h>
 #include "print.h"
+#include "timers.h"
+
+// The file itself is unbuffered, since OutFile does its own buffering.
+
+void OutFile::open(std::string fileName, const char *mode)
+{
+    close();
+
+    file = fopen(fileName.c_str(), mode);
+
+    if (file != NULL)
+        setvbuf(file, NULL, _IONBF, 0);
+}
+
+// Whole numbers, such as the spring constants, are written as integers, which
+// is much faster than the general conversion and gives the same text as long
+// as they have no more digits than are asked for.
+
+void OutFile::put(double x, int digits)
+{
+    static const double limits[] = {
+        1e15, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+        1e13, 1e14, 1e15, 1e15, 1e15
+    };
+
+    reserve(max_field);
+
+    char *first = buffer + used;
+
+    if (std::fabs(x) < limits[digits] && x == (double) (long long) x
+            && !(x == 0.0 && std::signbit(x)))
+    {
+        used = std::to_chars(first, first + max_field, (long long) x).ptr - buffer;
+        return;
+    }
+
+    std::to_chars_result result = digits > 0
+        ? std::to_chars(first, first + max_field, x, std::chars_format::general, digits)
+        : std::to_chars(first, first + max_field, x);
+
+    used = result.ptr - buffer;
+}
+
+OutFile &OutFile::operator<<(int n)
+{
+    reserve(max_field);
+
+    char *first = buffer + used;
+    used = std::to_chars(first, first + max_field, n).ptr - buffer;
+
+    return *this;
+}
+
+OutFile &OutFile::operator<<(const char *str)
+{
+    size_t len = strlen(str);
+
+    if (len > buffer_size)
+        len = buffer_size;
+
+    reserve(len);
+    memcpy(buffer + used, str, len);
+    used += len;
+
+    return *this;
+}
+
+// write hands the buffer to the file. Without an open file the data are
+// dropped.
+
+void OutFile::write()
+{
+    if (file != NULL && used > 0)
+    {
+        fwrite(buffer, 1, used, file);
+        TIMER_BYTES((double) used);
+    }
+
+    used = 0;
+}
+
+void OutFile::flush()
+{
+    write();
+}
+
+void OutFile::close()
+{
+    if (file == NULL)
+        return;
+
+    write();
+    fclose(file);
+    file = NULL;
+}
+
+long OutFile::tell() const
+{
+    return file != NULL ? ftell(file) + (long) used : 0;
+}
+
+void OutFile::rewind(long offset)
+{
+    if (file == NULL)
+        return;
+
+    write();
+
+    if (ftruncate(fileno(file), offset) == 0)
+        fseek(file, offset, SEEK_SET);
+}
 
 double Printer::affposx(int r, int c)
 {
@@ -16,15 +129,38 @@ double Printer::affposy(int r)
       return sqrt(3.0) / 2.0 * r;
 }
 
+void Printer::openNonAff(std::string nonaffFileName) {
+
+    nonaffFile.open(nonaffFileName, "w");
+
+    if (nonaffFile.is_open())
+        nonaffFile << p << "," << netSize << "," << TIMESTEP << "\n";
+
+}
+
+void Printer::openStress(std::string stressFileName) {
+
+    stressFile.open(stressFileName, "w");
+
+}
+
+void Printer::openEnergy(std::string energyFileName) {
+
+    energyFile.open(energyFileName, "a");
+
+}
+
 void Printer::printPos(std::string posFileName) {
 
-    std::ofstream posFile(posFileName.c_str(), std::ios::trunc);
+    posFile.open(posFileName, "w");
+
+    OutFile &out = posFile;
 
-    if (posFile.is_open()) {
+    if (out.is_open()) {
 
-        posFile << "NetSize,Strain,YoungMod,pbond,Spr1,Spr2,Spr3" << std::endl;
-        posFile << netSize << "," << affdel << "," << YOUNGMOD << ","
-            << p << ",1,1,1" << std::endl;
+        out << "NetSize,Strain,YoungMod,pbond,Spr1,Spr2,Spr3\n";
+        out << netSize << "," << affdel << "," << YOUNGMOD << ","
+            << p << ",1,1,1\n";
 
         for (int i = 0; i < netSize; i++) {
 
@@ -32,82 +168,90 @@ void Printer::printPos(std::string posFileName) {
 
                 // Print row, col, position, sprstiff, rlen information to file.
 
-                posFile << i << "," << j << "," << pos[(i * netSize + j) * 2] - affposx(i, j)
+                out << i << "," << j << ","
+                    << boundary.image(pos[(i * netSize + j) * 2] - affposx(i, j))
                     << "," << pos[(i * netSize + j) * 2 + 1] - affposy(i);
 
                 for (int k = 0; k < 3; k++)
-                    posFile << "," << spr[i][j][k];
+                    out << "," << spr[i][j][k];
 
-                posFile << "\n";
+                out << "\n";
             }
 
         }
-
     }
 
     posFile.close();
 }
 
-void Printer::printNonAff(std::string nonaffFileName, int i, double str_rate) {
+void Printer::printNonAff(int i, double str_rate, double nonaff,
+        double nonaffdd) {
 
-    if (i == 0)
-        clearNonAffFile(nonaffFileName);
+    if (nonaffFile.is_open())
+        nonaffFile << i * TIMESTEP << "," << affdel << ","
+            << nonaff << "," << str_rate << "," << nonaffdd << "\n";
 
-    std::ofstream nonaffFile(nonaffFileName.c_str(), std::ios::app);
-
-    if (nonaffFile.is_open()) {
-        if (i == 0) {
-            nonaffFile << p << "," << netSize << "," << TIMESTEP << std::endl;
-        } else {
-            double nonaff = nonAffinity(pos);
-            double nonaffdd = nonAffinity_dd(pos, del, str_rate);
-            nonaffFile << i * TIMESTEP << "," << affdel << ","
-                << nonaff << "," << str_rate << "," << nonaffdd << std::endl;
-        }
-    }
+}
 
-    nonaffFile.close();
+void Printer::printEnergy(const double &newEnergy) {
 
-}
+    if (energyFile.is_open())
+        energyFile << newEnergy << "," << p << "," << affdel << "\n";
 
-void Printer::clearNonAffFile(std::string nonaffFileName)
-{
-  std::ofstream nonaffFile(nonaffFileName.c_str(), std::ios::trunc);
-  nonaffFile.close();
 }
 
-void Printer::printEnergy(std::string energyFileName, const double &newEnergy) {
+void Printer::printStress(int i, double stress, double strain) {
 
-    std::ofstream engFile(energyFileName.c_str(), std::ios::app);
+    if (stressFile.is_open()) {
 
-    if (engFile.is_open()) {
+        // The time is always written in full.
 
-        engFile << newEnergy << "," << p << "," << affdel << std::endl;
+        stressFile << stress << "," << strain << ",";
+        stressFile.put(i * TIMESTEP, 0);
+        stressFile << "\n";
 
     }
 
-    engFile.close();
+}
+
+void Printer::flush() {
+
+    nonaffFile.flush();
+    stressFile.flush();
+    energyFile.flush();
 
 }
 
-void Printer::printStress(std::string stressFileName, const double* stress_array,
-        const double* strain_array) {
+void Printer::close() {
 
-    std::ofstream stressFile(stressFileName.c_str(), std::ios::trunc);
+    nonaffFile.close();
+    stressFile.close();
+    energyFile.close();
 
-    if (stressFile.is_open()) {
+}
 
-        for (int i = 0; i < n_time_steps; i += fs) {
+Printer::Mark Printer::mark() const {
 
-            std::string time = boost::lexical_cast<std::string>(i * TIMESTEP);
+    Mark m;
+    m.nonaff = nonaffFile.tell();
+    m.stress = stressFile.tell();
 
-            stressFile << stress_array[i] << "," << strain_array[i] << ",";
-            stressFile << time << std::endl;
+    return m;
 
-        }
+}
 
-    }
+void Printer::rewind(const Mark &m) {
 
-    stressFile.close();
+    nonaffFile.rewind(m.nonaff);
+    stressFile.rewind(m.stress);
+
+}
+
+void Printer::setPrecision(int digits) {
+
+    posFile.precision = digits;
+    nonaffFile.precision = digits;
+    stressFile.precision = digits;
+    energyFile.precision = digits;
 
 }
@@ -8,8 +8,7 @@
 
 #include <string>
 #include <cstring>
-#include <fstream>
-#include <sstream>
+#include <cstdio>
 #include "network.h"
 
 #include "nonaffinity.h"
@@ -24,6 +23,56 @@ extern int frame_sep;
 
 extern double affdel;
 
+// OutFile is an output file with a large buffer of its own. Printer keeps
+// its files open for the whole run, so each record only costs a copy into the
+// buffer; the data reach the file system at the explicit flush points.
+//
+// Numbers are formatted straight into the buffer with std::to_chars, so
+// writing a value never allocates. Doubles are written with precision
+// significant digits, like printf's %g, or with the fewest digits that read
+// back to the same double when precision is 0.
+
+struct OutFile {
+
+    enum {buffer_size = 1 << 20};
+    enum {max_field = 32};      // Longest formatted number
+
+    int precision;
+
+    OutFile() : precision(6), file(NULL), buffer(new char[buffer_size]), used(0) {}
+    ~OutFile() { close(); delete[] buffer; }
+
+    // mode is passed to fopen.
+    void open(std::string /*fileName*/, const char * /*mode*/);
+    bool is_open() const { return file != NULL; }
+
+    // put writes x with the given number of significant digits.
+    void put(double x, int digits);
+
+    OutFile &operator<<(double x) { put(x, precision); return *this; }
+    OutFile &operator<<(int n);
+    OutFile &operator<<(const char *str);
+
+    void flush();
+    void close();
+
+    // tell returns the number of bytes written so far, and rewind drops
+    // everything written after the first offset bytes.
+    long tell() const;
+    void rewind(long /*offset*/);
+
+    private:
+
+    FILE *file;
+    char *buffer;
+    size_t used;                // Bytes in the buffer
+
+    // reserve makes room for n more bytes in the buffer.
+    inline void reserve(size_t n) { if (used + n > buffer_size) write(); }
+    void write();
+
+};
+
 struct Printer {
 
     double p;
@@ -32,6 +81,7 @@ struct Printer {
     double *pos;
     double *del;
     double ***spr;
+    const LeesEdwards &boundary;
 
     Printer(const Network &net, const double &pp, const double &nts, const double &fskip) :
         p(pp),
@@ -39,20 +89,57 @@ struct Printer {
         fs(fskip),
         pos(net.pos),
         del(net.delta),
-        spr(net.spring) {}
+        spr(net.spring),
+        boundary(net.boundary) {}
 
     double affposx(int r, int c);
     double affposy(int r);
 
+    // These open the files for the whole run. The nonaffinity and stress
+    // files are truncated, and the header of the nonaffinity file is written
+    // once here. The energy file is appended to. A file that is not opened
+    // is simply not written.
+    void openNonAff(std::string /*nonaffFileName*/);
+    void openStress(std::string /*stressFileName*/);
+    void openEnergy(std::string /*energyFileName*/);
+
+    // printPos writes a separate file for every frame.
     void printPos(std::string /*fileName*/);
 
-    void printNonAff(std::string /*nonaffFileName*/, int /* time */, double /* str_rate */);
-    void clearNonAffFile(std::string /*nonaffFileName*/);
+    // printNonAff writes one line of the nonaffinity time series. The two
+    // measures are passed in, since the node mover accumulates them.
+    void printNonAff(int /* time */, double /* str_rate */, double /* nonaff */,
+            double /* nonaffdd */);
+
+    void printEnergy(const double & /*newEnergy*/);
+
+    // printStress writes the stress and strain at time step i. The
+    // integrator calls it at every frame.
+    void printStress(int /* time */, double /* stress */, double /* strain */);
+
+    // flush writes out everything buffered so far. The integrator calls it
+    // at every frame; the files are also flushed when they are closed.
+    void flush();
+    void close();
+
+    // setPrecision sets the significant digits of every double written
+    // (0: as many as are needed to read the double back exactly).
+    void setPrecision(int /*digits*/);
+
+    // A Mark is how far the nonaffinity and stress files have been written.
+    // rewind truncates them back to a mark, so that steps which are
+    // integrated again (see health.h) are not written twice.
+    struct Mark {
+        long nonaff, stress;
+        Mark() : nonaff(0), stress(0) {}
+    };
+
+    Mark mark() const;
+    void rewind(const Mark & /*mark*/);
 
-    void printEnergy(std::string /*fileName*/, const double & /*newEnergy*/);
+    private:
 
-    // Prints the stress of the network for every tenth time point.
-    void printStress(std::string /*fileName*/, const double* stress, const double* strain);
+    OutFile posFile, nonaffFile, stressFile, energyFile;
 
 };
 
@@ -0,0 +1,200 @@
+// protocol.cpp
+// ------------
+//
+// protocol.cpp implements the strain protocols of protocol.h.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <algorithm>
+
+#include "protocol.h"
+
+static const char *kindNames[Protocol::num_kinds] = {
+    "sine", "step", "ramp", "laos", "table"
+};
+
+Protocol::Protocol(Kind kkind, double a, double w, double dt, double aFinal,
+        int n) :
+    kind(kkind),
+    amplitude(a),
+    frequency(w),
+    timestep(dt),
+    finalAmplitude(aFinal),
+    cycles(n > 0 ? n : 1)
+{
+}
+
+Protocol::Kind Protocol::parseKind(std::string name)
+{
+    for (int k = 0; k < num_kinds; k++)
+        if (name == kindNames[k])
+            return (Kind) k;
+
+    return num_kinds;
+}
+
+int Protocol::load(std::string fileName, double scale)
+{
+    std::ifstream file(fileName.c_str());
+
+    if (!file.is_open())
+    {
+        printf("Couldn't open the protocol table %s.\n", fileName.c_str());
+        return 1;
+    }
+
+    std::string line;
+    int number = 0;
+
+    times.clear();
+    values.clear();
+
+    while (std::getline(file, line))
+    {
+        number++;
+        line = line.substr(0, line.find('#'));
+        std::replace(line.begin(), line.end(), ',', ' ');
+
+        double t, value;
+        char rest;
+        int fields = sscanf(line.c_str(), "%lf %lf %c", &t, &value, &rest);
+
+        if (fields <= 0)
+            continue;
+
+        if (fields != 2)
+        {
+            printf("%s:%d: expected a time and a value.\n", fileName.c_str(), number);
+            return 1;
+        }
+
+        if (!times.empty() && t <= times.back())
+        {
+            printf("%s:%d: the times must increase.\n", fileName.c_str(), number);
+            return 1;
+        }
+
+        times.push_back(t);
+        values.push_back(value * scale);
+    }
+
+    if (times.empty())
+    {
+        printf("The protocol table %s has no points.\n", fileName.c_str());
+        return 1;
+    }
+
+    return 0;
+}
+
+double Protocol::tableValue(double t) const
+{
+    if (t <= times.front())
+        return values.front();
+    if (t >= times.back())
+        return values.back();
+
+    size_t b = std::upper_bound(times.begin(), times.end(), t) - times.begin();
+    double f = (t - times[b - 1]) / (times[b] - times[b - 1]);
+
+    return values[b - 1] + f * (values[b] - values[b - 1]);
+}
+
+// sweepAmplitude returns the amplitude of a sweep at time t. It changes where
+// the waveform is zero, so the waveform stays continuous.
+
+static double sweepAmplitude(const Protocol &p, double t)
+{
+    int k = (int) (p.frequency * t / (2 * M_PI));
+
+    return p.cycles > 1 && k > 0
+        ? p.amplitude * pow(p.finalAmplitude / p.amplitude,
+                std::min(k, p.cycles - 1) / (p.cycles - 1.0))
+        : p.amplitude;
+}
+
+double Protocol::value(double t) const
+{
+    switch (kind)
+    {
+        case sine:
+            return amplitude * sin(frequency * t);
+
+        case step:
+            return t > 0 ? amplitude : 0.0;
+
+        case ramp:
+            return amplitude * frequency * t;
+
+        case laos:
+            return sweepAmplitude(*this, t) * sin(frequency * t);
+
+        case table:
+            return tableValue(t);
+
+        default:
+            return 0.0;
+    }
+}
+
+double Protocol::rate(int i) const
+{
+    switch (kind)
+    {
+        case sine:
+            return amplitude * frequency * cos(frequency * i * timestep);
+
+        case step:
+            return i == 0 ? amplitude / timestep : 0.0;
+
+        case ramp:
+            return amplitude * frequency;
+
+        case laos:
+            return sweepAmplitude(*this, i * timestep) * frequency
+                * cos(frequency * i * timestep);
+
+        case table:
+            return (tableValue((i + 1) * timestep) - tableValue(i * timestep))
+                / timestep;
+
+        default:
+            return 0.0;
+    }
+}
+
+StressControl::StressControl(const Protocol &ttarget, double ggain,
+        double iintegralGain) :
+    target(ttarget),
+    gain(ggain),
+    integralGain(iintegralGain),
+    rate(0.0),
+    lastRate(0.0),
+    integral(0.0)
+{
+}
+
+void StressControl::update(int i, double stress)
+{
+    double error = target.value(i * target.timestep) - stress;
+
+    integral += error * target.timestep;
+    lastRate = rate;
+    rate = gain * error + integralGain * integral;
+}
+
+void StressControl::save(double *state) const
+{
+    state[0] = rate;
+    state[1] = lastRate;
+    state[2] = integral;
+}
+
+void StressControl::restore(const double *state)
+{
+    rate = state[0];
+    lastRate = state[1];
+    integral = state[2];
+}
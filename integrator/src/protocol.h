@@ -0,0 +1,118 @@
+#ifndef PROTOCOL_H_
+#define PROTOCOL_H_
+
+// protocol.h
+// ----------
+//
+// protocol.h defines the struct Protocol, the strain protocol that drives the
+// network. The integrators ask it for the shear rate of each step as they go
+// (rate(i)), so nothing of the length of the run is stored. A protocol is
+// chosen with --protocol (also in the config file):
+//
+//   sine   γ(t) = e sin(ω t), the oscillation of -e and -r (the default)
+//   step   γ jumps to e in the first step and is held there, for stress
+//          relaxation
+//   ramp   γ grows at the constant rate e ω, the peak rate of the oscillation
+//   laos   an amplitude sweep of large amplitude oscillatory shear: one
+//          oscillation of frequency ω per amplitude, the amplitudes growing
+//          geometrically from e to --laos-strain over the num-osc
+//          oscillations of the run
+//   table  γ(t) interpolated linearly between the points of the file
+//          --protocol-table, and held at the last one (see load). The network
+//          follows the changes of γ from the strain 0 it starts at, so the
+//          table should start at 0 as well.
+//
+// The time step and the length of the run still follow from -r and num-osc,
+// so ω sets the time scale of every protocol.
+//
+// Under stress control (--control stress) the same waveforms are the target
+// stress instead, with the amplitude --stress (and --laos-stress), and
+// StressControl finds the shear rates that follow it: step is a creep test,
+// sine an oscillatory stress.
+//
+// StressControl uses a PI feedback law on the stress that every step already
+// computes from the forces of its nodes, so it costs no pass of its own over
+// the network. With the error e = σ*(t) - σ between the target and the
+// measured stress, the rate of the next step is
+//
+//   rate = gain e + integralGain ∫ e dt
+//
+// The rate of a step follows from the stress measured in the step before, so
+// the fused step of Network::step, which computes the stress in the same sweep
+// that moves the nodes, is controlled the same way as the separate kernels.
+// The rate is in the units of affvx, close to the rate of the strain column
+// of the stress file, so the gain is that rate per unit of stress.
+
+#include <string>
+#include <vector>
+
+struct Protocol {
+
+    enum Kind {sine, step, ramp, laos, table, num_kinds};
+
+    Kind kind;
+    double amplitude;   // Amplitude a of the waveform
+    double frequency;   // ω
+    double timestep;    // Time per step, fixed when the protocol is made
+    double finalAmplitude; // Last amplitude of a sweep
+    int cycles;         // Oscillations of a sweep
+
+    // Protocol makes the protocol of the given kind with amplitude a and
+    // frequency w with steps of dt. A sweep goes up to the amplitude aFinal
+    // in n oscillations.
+    Protocol(Kind kind, double a, double w, double dt, double aFinal = 0.0,
+            int n = 1);
+
+    // parseKind returns the kind with the given name, or num_kinds if there
+    // is none.
+    static Kind parseKind(std::string name);
+
+    // load reads the points of a table protocol from a file with one point
+    // "t, value" per line (spaces also separate, # starts a comment), and
+    // multiplies the values by scale. The times must increase. It returns 0,
+    // or 1 after printing what went wrong. The value is held at its first
+    // before the first time.
+    int load(std::string fileName, double scale);
+
+    // value returns the waveform at time t.
+    double value(double t) const;
+
+    // rate returns the shear rate during step i, in the units of affvx, of
+    // the waveform as a strain.
+    double rate(int i) const;
+
+    private:
+
+    std::vector<double> times, values;
+
+    // tableValue returns the value of the table at time t.
+    double tableValue(double t) const;
+
+};
+
+// StressControl is the feedback law that makes the stress follow the waveform
+// of a protocol.
+struct StressControl {
+
+    Protocol target;    // Target stress σ*(t)
+    double gain;        // Shear rate per unit of stress error
+    double integralGain; // Shear rate per unit of time integral of the error
+    double rate;        // Shear rate of the current step
+    double lastRate;    // Shear rate of the step before
+    double integral;    // Time integral of the error so far
+
+    StressControl(const Protocol &target, double gain, double integralGain);
+
+    // update takes the stress measured in step i and sets the rate of the
+    // next step.
+    void update(int i, double stress);
+
+    // save and restore copy the state of the controller (num_state values)
+    // for the health monitor.
+    enum {num_state = 3};
+    void save(double *state) const;
+    void restore(const double *state);
+
+};
+
+#endif /* PROTOCOL_H_ */
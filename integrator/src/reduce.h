@@ -0,0 +1,62 @@
+#ifndef REDUCE_H_
+#define REDUCE_H_
+
+// reduce.h
+// --------
+//
+// reduce.h provides the sums behind the stress, energy and nonaffinity of the
+// network. They are summed in blocks of one row of the network: each row is
+// summed in order of its nodes with Neumaier's compensated summation, and the
+// row sums are then added, again compensated, in order of the rows. How the
+// rows are split between processes (or tiles of the fused step) therefore
+// doesn't change a single bit of the result, and the compensation keeps the
+// rounding error of a sum of N^2 terms near that of a single addition.
+
+#include <cmath>
+
+struct Neumaier {
+
+    double sum;
+    double comp;    // Low-order bits lost from sum so far
+
+    Neumaier() : sum(0.0), comp(0.0) {}
+
+    inline void add(double x) {
+
+        double t = sum + x;
+
+        if (std::abs(sum) >= std::abs(x))
+            comp += (sum - t) + x;
+        else
+            comp += (x - t) + sum;
+
+        sum = t;
+    }
+
+    inline double value() const { return sum + comp; }
+
+};
+
+// nanMax returns the larger of m and x, or NaN if either of them is NaN, so
+// that a NaN anywhere survives a maximum over many values.
+inline double nanMax(double m, double x)
+{
+    if (m != m)
+        return m;
+
+    return x > m || x != x ? x : m;
+}
+
+// sumRows returns the compensated sum of the n row sums rows[0 .. n - 1], in
+// that order.
+inline double sumRows(const double *rows, int n)
+{
+    Neumaier total;
+
+    for (int i = 0; i < n; i++)
+        total.add(rows[i]);
+
+    return total.value();
+}
+
+#endif /* REDUCE_H_ */
@@ -0,0 +1,369 @@
+// render.cpp
+// ----------
+//
+// render.cpp implements the struct Renderer of render.h.
+
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include "render.h"
+
+static const char *coloringNames[Renderer::num_colorings] = {
+    "tension", "nonaffine"
+};
+
+// Colors of the tension coloring: unstretched, stretched and compressed
+// bonds, and the nodes.
+
+static const unsigned char relaxedColor[3] = {170, 170, 170};
+static const unsigned char stretchedColor[3] = {210, 30, 30};
+static const unsigned char compressedColor[3] = {30, 70, 210};
+static const unsigned char nodeColor[3] = {60, 60, 60};
+
+// Color map of the nonaffine coloring, from no displacement to the largest
+// one in the frame.
+
+enum {num_stops = 5};
+
+static const unsigned char colorStops[num_stops][3] = {
+    {20, 20, 140}, {20, 140, 220}, {60, 190, 90}, {240, 200, 30}, {200, 20, 20}
+};
+
+static void blend(const unsigned char *a, const unsigned char *b, double t,
+        unsigned char *rgb)
+{
+    for (int c = 0; c < 3; c++)
+        rgb[c] = (unsigned char) (a[c] + t * (b[c] - a[c]) + 0.5);
+}
+
+// color sets rgb to the color of a value that has been scaled to [-1, 1]
+// (tension) or [0, 1] (nonaffine displacement).
+
+static void color(Renderer::Coloring coloring, double v, unsigned char *rgb)
+{
+    v = std::max(-1.0, std::min(1.0, v));
+
+    if (coloring == Renderer::color_tension)
+    {
+        if (v >= 0)
+            blend(relaxedColor, stretchedColor, v, rgb);
+        else
+            blend(relaxedColor, compressedColor, -v, rgb);
+        return;
+    }
+
+    double s = std::max(0.0, v) * (num_stops - 1);
+    int stop = std::min((int) s, num_stops - 2);
+    blend(colorStops[stop], colorStops[stop + 1], s - stop, rgb);
+}
+
+Renderer::Renderer(const Network &nnet, int wwidth,
+        const std::vector<Coloring> &ccolorings, std::string ppath, bool sstream) :
+    net(nnet),
+    width(wwidth + wwidth % 2),
+    colorings(ccolorings),
+    path(ppath),
+    stream(sstream),
+    front(&snapshots[0]),
+    back(&snapshots[1]),
+    pending(false),
+    stop(false)
+{
+    // Both sides are even, as H.264 with yuv420p (moviemaker.sh) needs.
+
+    scale = width / net.boundary.width;
+    height = (int) (net.boundary.height * scale + 0.5);
+    height += height % 2;
+
+    image.resize(3 * width * height);
+    nodeValues.resize(netSize * netSize);
+    bondValues.resize(3 * netSize * netSize);
+
+    for (int s = 0; s < 2; s++)
+    {
+        snapshots[s].pos.resize(2 * netSize * netSize);
+        snapshots[s].spring.resize(3 * netSize * netSize);
+    }
+
+    if (stream)
+    {
+        for (size_t c = 0; c < colorings.size(); c++)
+        {
+            std::string fileName = path + "_" + coloringNames[colorings[c]] + ".ppm";
+            streams.push_back(fopen(fileName.c_str(), "wb"));
+        }
+    }
+
+    worker = std::thread(&Renderer::run, this);
+}
+
+Renderer::~Renderer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+
+    changed.notify_all();
+    worker.join();
+
+    for (size_t c = 0; c < streams.size(); c++)
+        if (streams[c] != NULL)
+            fclose(streams[c]);
+}
+
+Renderer::Coloring Renderer::parseColoring(std::string name)
+{
+    for (int c = 0; c < num_colorings; c++)
+        if (name == coloringNames[c])
+            return (Coloring) c;
+
+    return num_colorings;
+}
+
+void Renderer::submit(int frame)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (pending)
+        changed.wait(lock);
+
+    std::copy(net.pos, net.pos + 2 * netSize * netSize, back->pos.begin());
+
+    for (int i = 0; i < netSize; i++)
+        for (int j = 0; j < netSize; j++)
+            std::copy(net.spring[i][j], net.spring[i][j] + 3,
+                    back->spring.begin() + 3 * (i * netSize + j));
+
+    back->boundary = net.boundary;
+    back->affdel = affdel;
+    back->frame = frame;
+
+    pending = true;
+    lock.unlock();
+    changed.notify_all();
+}
+
+// run is the body of the background thread. It draws the queued frames
+// until the renderer is destroyed and nothing is queued any more.
+
+void Renderer::run()
+{
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            while (!pending && !stop)
+                changed.wait(lock);
+
+            if (!pending)
+                return;
+
+            std::swap(front, back);
+            pending = false;
+        }
+
+        changed.notify_all();
+
+        for (size_t c = 0; c < colorings.size(); c++)
+        {
+            draw(*front, colorings[c]);
+            write(*front, c);
+        }
+    }
+}
+
+// draw works out the value of every node and bond for the coloring, scales
+// the values by the largest one in the frame and draws the tiles.
+
+void Renderer::draw(const Snapshot &snap, Coloring coloring)
+{
+    const double *pos = &snap.pos[0];
+    const LeesEdwards &boundary = snap.boundary;
+    double largest = 0.0;
+
+    for (int i = 0; i < netSize; i++)
+    {
+        for (int j = 0; j < netSize; j++)
+        {
+            int n = i * netSize + j;
+
+            if (coloring == color_nonaffine)
+            {
+                // The affine position of the node, as in Printer::affposx.
+                double affx = j + i / 2.0
+                    + snap.affdel / 2.0 * ((2.0 * i) / (netSize - 1.0) - 1.0);
+                double dx = boundary.image(pos[2 * n] - affx);
+                double dy = pos[2 * n + 1] - sqrt(3.0) / 2.0 * i;
+
+                nodeValues[n] = sqrt(dx * dx + dy * dy);
+                largest = std::max(largest, nodeValues[n]);
+                continue;
+            }
+
+            for (int k = 0; k < 3; k++)
+            {
+                int m = net.neighbors[3 * n + k];
+                int cross = net.crossings[3 * n + k];
+                double dx = boundary.dx(pos[2 * m] - pos[2 * n], cross);
+                double dy = boundary.dy(pos[2 * m + 1] - pos[2 * n + 1], cross);
+
+                bondValues[3 * n + k] = snap.spring[3 * n + k]
+                    * (sqrt(dx * dx + dy * dy) - RESTLEN);
+                largest = std::max(largest, std::abs(bondValues[3 * n + k]));
+            }
+        }
+    }
+
+    if (coloring == color_nonaffine)
+    {
+        for (int n = 0; n < netSize * netSize; n++)
+            for (int k = 0; k < 3; k++)
+                bondValues[3 * n + k] = 0.5
+                    * (nodeValues[n] + nodeValues[net.neighbors[3 * n + k]]);
+    }
+
+    double norm = largest > 0.0 ? 1.0 / largest : 0.0;
+
+    for (size_t b = 0; b < bondValues.size(); b++)
+        bondValues[b] *= norm;
+
+    for (size_t n = 0; n < nodeValues.size(); n++)
+        nodeValues[n] *= norm;
+
+    currentColoring = coloring;
+
+    // Draw the tiles, one per hardware thread, using this thread for the
+    // first one.
+
+    int tiles = std::max(1, std::min((int) std::thread::hardware_concurrency(), height));
+    int tileHeight = (height + tiles - 1) / tiles;
+    std::vector<std::thread> threads;
+
+    for (int t = 1; t < tiles; t++)
+        threads.push_back(std::thread(&Renderer::drawTile, this, std::cref(snap),
+                    std::min(height, t * tileHeight), std::min(height, (t + 1) * tileHeight)));
+
+    drawTile(snap, 0, std::min(height, tileHeight));
+
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+}
+
+// drawTile draws the pixel rows [yBegin, yEnd) of the image. Every tile goes
+// through all bonds and nodes, but only sets the pixels in its own rows, so
+// the tiles never write to the same memory. Pixels outside the image are
+// wrapped around, which draws the periodic images of the bonds.
+
+void Renderer::drawTile(const Snapshot &snap, int yBegin, int yEnd)
+{
+    const double *pos = &snap.pos[0];
+    const LeesEdwards &boundary = snap.boundary;
+    unsigned char rgb[3];
+
+    // The rows of nodes are centred in the image, half a row spacing from
+    // its top and bottom.
+    double top = boundary.height - sqrt(3.0) / 4.0;
+
+    std::fill(image.begin() + 3 * width * yBegin, image.begin() + 3 * width * yEnd, 255);
+
+    for (int n = 0; n < netSize * netSize; n++)
+    {
+        double x0 = pos[2 * n] - boundary.width * floor(pos[2 * n] / boundary.width);
+        double y0 = pos[2 * n + 1];
+
+        for (int k = 0; k < 3; k++)
+        {
+            if (snap.spring[3 * n + k] == 0.0)
+                continue;
+
+            int m = net.neighbors[3 * n + k];
+            int cross = net.crossings[3 * n + k];
+            double dx = boundary.dx(pos[2 * m] - pos[2 * n], cross);
+            double dy = boundary.dy(pos[2 * m + 1] - pos[2 * n + 1], cross);
+
+            color(currentColoring, bondValues[3 * n + k], rgb);
+
+            // Step along the bond one pixel at a time.
+
+            int steps = (int) ceil(std::max(std::abs(dx), std::abs(dy)) * scale) + 1;
+
+            for (int s = 0; s <= steps; s++)
+            {
+                double t = s / (double) steps;
+                int py = (int) floor((top - (y0 + t * dy)) * scale);
+                py = ((py % height) + height) % height;
+
+                if (py < yBegin || py >= yEnd)
+                    continue;
+
+                int px = (int) floor((x0 + t * dx) * scale);
+                px = ((px % width) + width) % width;
+
+                std::copy(rgb, rgb + 3, &image[3 * (py * width + px)]);
+            }
+        }
+    }
+
+    // The nodes are drawn on top of the bonds.
+
+    int radius = std::max(1, (int) (0.12 * scale));
+
+    for (int n = 0; n < netSize * netSize; n++)
+    {
+        if (currentColoring == color_nonaffine)
+            color(currentColoring, nodeValues[n], rgb);
+        else
+            std::copy(nodeColor, nodeColor + 3, rgb);
+
+        double x0 = pos[2 * n] - boundary.width * floor(pos[2 * n] / boundary.width);
+        int cx = (int) floor(x0 * scale);
+        int cy = (int) floor((top - pos[2 * n + 1]) * scale);
+
+        for (int oy = -radius; oy <= radius; oy++)
+        {
+            int py = (((cy + oy) % height) + height) % height;
+
+            if (py < yBegin || py >= yEnd)
+                continue;
+
+            for (int ox = -radius; ox <= radius; ox++)
+            {
+                if (ox * ox + oy * oy > radius * radius)
+                    continue;
+
+                int px = (((cx + ox) % width) + width) % width;
+                std::copy(rgb, rgb + 3, &image[3 * (py * width + px)]);
+            }
+        }
+    }
+}
+
+void Renderer::write(const Snapshot &snap, int c)
+{
+    FILE *file;
+
+    if (stream)
+    {
+        file = streams[c];
+    }
+    else
+    {
+        char frame[16];
+        snprintf(frame, sizeof(frame), "_%d", snap.frame);
+        std::string fileName = path + "_" + coloringNames[colorings[c]] + frame + ".ppm";
+        file = fopen(fileName.c_str(), "wb");
+    }
+
+    if (file == NULL)
+        return;
+
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    fwrite(&image[0], 1, image.size(), file);
+
+    if (stream)
+        fflush(file);
+    else
+        fclose(file);
+}
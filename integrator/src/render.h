@@ -0,0 +1,95 @@
+#ifndef RENDER_H_
+#define RENDER_H_
+
+// render.h
+// --------
+//
+// render.h defines the struct Renderer, which draws frames of the network
+// into images while the simulation goes on, so that movies no longer need
+// the position files and MATLAB. The nodes and bonds are drawn into RGB
+// images that are written as binary PPM files, either one file per frame or
+// all frames of a movie appended to one file (a frame stream, which ffmpeg
+// reads with -f image2pipe -c:v ppm).
+//
+// submit only copies the positions and springs of the network; the drawing
+// and writing happen on a background thread, which splits every image into
+// horizontal tiles that are drawn in parallel. If the previous frame is still
+// being drawn, submit waits for it, so at most one frame is ever queued.
+//
+// The image shows one period of the sheared periodic network, and bonds that
+// leave it on one side come back in on the other.
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "network.h"
+
+extern const double RESTLEN;
+extern int netSize;
+extern double affdel;
+
+struct Renderer {
+
+    // The quantities the bonds and nodes can be colored by. Tension colors
+    // stretched bonds red and compressed ones blue; the nonaffine coloring
+    // shows how far each node is from its affine position.
+    enum Coloring {color_tension, color_nonaffine, num_colorings};
+
+    // Renderer draws images width pixels wide for each of the colorings,
+    // with the width and the height rounded up to even numbers.
+    // Every image is written to path + "_" + the name of the coloring,
+    // followed by "_" and the frame number unless stream is set, and ".ppm".
+    Renderer(const Network &net, int width, const std::vector<Coloring> &colorings,
+            std::string path, bool stream);
+
+    // The destructor waits until the last frame has been written.
+    ~Renderer();
+
+    // submit queues the current state of the network as the given frame.
+    void submit(int frame);
+
+    // parseColoring returns the coloring with the given name ("tension" or
+    // "nonaffine"), or num_colorings if there is none.
+    static Coloring parseColoring(std::string name);
+
+    private:
+
+    // A copy of the network at the time of a frame.
+    struct Snapshot {
+        std::vector<double> pos;
+        std::vector<double> spring;
+        LeesEdwards boundary;
+        double affdel;
+        int frame;
+    };
+
+    const Network &net;
+    int width, height;
+    double scale;               // Pixels per unit length
+    std::vector<Coloring> colorings;
+    std::string path;
+    bool stream;
+
+    std::vector<FILE *> streams;    // Open frame streams, one per coloring
+    std::vector<unsigned char> image;
+    std::vector<double> nodeValues, bondValues;   // Scaled to [-1, 1]
+    Coloring currentColoring;   // Coloring of the image being drawn
+
+    Snapshot snapshots[2];
+    Snapshot *front, *back;     // Being drawn, and being filled by submit
+    bool pending, stop;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::thread worker;
+
+    void run();
+    void draw(const Snapshot &snap, Coloring coloring);
+    void drawTile(const Snapshot &snap, int yBegin, int yEnd);
+    void write(const Snapshot &snap, int c);
+
+};
+
+#endif /* RENDER_H_ */
@@ -0,0 +1,387 @@
+// replicas.cpp
+// ------------
+//
+// replicas.cpp implements the struct Replicas of replicas.h and the replica
+// mode of the integrator.
+
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
+#include "replicas.h"
+#include "MersenneTwister.h"
+#include "utils.h"
+#include "print.h"
+#include "status.h"
+
+// nearest rounds x to the nearest integer. Adding and subtracting 1.5 * 2^52
+// leaves only the integer part of x (for |x| < 2^51); unlike floor, this
+// compiles to plain SIMD additions on every x86-64 processor. It differs from
+// floor(x + 0.5) only for x exactly halfway between two integers.
+
+static inline double nearest(double x)
+{
+    const double magic = 6755399441055744.0;
+    return (x + magic) - magic;
+}
+
+Replicas::Replicas(double pBond, unsigned int seed) :
+    accumNonAff(false)
+{
+    int nodes = netSize * netSize;
+
+    pos = new double[2 * nodes * lanes];
+    delta = new double[2 * nodes * lanes]();
+    spring = new double[3 * nodes * lanes];
+    forces = new double[6 * nodes * lanes];
+    kicks = new double[2 * netSize * lanes];
+
+    neighbors = new int[3 * nodes];
+    crossings = new signed char[3 * nodes];
+    buildNeighborTables(neighbors, crossings);
+
+    for (int l = 0; l < lanes; l++)
+    {
+        // The same sequence of calls to rand as in integrator.cpp.
+        srand(seed + l);
+
+        for (int i = 0; i < netSize; i++)
+        {
+            for (int j = 0; j < netSize; j++)
+            {
+                int n = i * netSize + j;
+
+                pos[2 * n * lanes + l] = RESTLEN * (i / 2.0 + j);
+                pos[(2 * n + 1) * lanes + l] = sqrt(3) / 2 * RESTLEN * i;
+
+                double *springs = stiffVecGen(pBond, 3);
+
+                for (int k = 0; k < 3; k++)
+                    spring[(3 * n + k) * lanes + l] = springs[k];
+
+                delete[] springs;
+            }
+        }
+
+        noise[l] = new MTRand(seed + l);
+        stress[l] = nonAff[l] = nonAffdd[l] = 0.0;
+    }
+}
+
+Replicas::~Replicas()
+{
+    for (int l = 0; l < lanes; l++)
+        delete noise[l];
+
+    delete[] pos;
+    delete[] delta;
+    delete[] spring;
+    delete[] forces;
+    delete[] kicks;
+    delete[] neighbors;
+    delete[] crossings;
+}
+
+// The kernels below take their arrays as __restrict__ arguments. This tells
+// the compiler that the arrays do not overlap, which it needs to know before
+// it will turn the loops over the lanes into SIMD instructions.
+
+static void forceKernel(const double *__restrict__ pos,
+        const double *__restrict__ spring, double *__restrict__ forces,
+        const int *neighbors, const signed char *crossings,
+        const LeesEdwards &boundary)
+{
+    const int lanes = Replicas::lanes;
+    double width = boundary.width;
+
+    for (int n = 0; n < netSize * netSize; n++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            int m = neighbors[3 * n + k];
+            double shift = crossings[3 * n + k] * boundary.offset;
+            double lift = crossings[3 * n + k] * boundary.height;
+
+            const double *xn = pos + 2 * n * lanes, *yn = xn + lanes;
+            const double *xm = pos + 2 * m * lanes, *ym = xm + lanes;
+            const double *s = spring + (3 * n + k) * lanes;
+            double *fx = forces + (6 * n + 2 * k) * lanes, *fy = fx + lanes;
+
+            for (int l = 0; l < lanes; l++)
+            {
+                double dx = xm[l] - xn[l] + shift;
+                dx -= width * nearest(dx / width);
+                double dy = ym[l] - yn[l] + lift;
+                double dist = sqrt(dx * dx + dy * dy);
+
+                double temp = s[l] * (dist - RESTLEN) / RESTLEN;
+
+                fx[l] = temp * (dx / dist);
+                fy[l] = temp * (dy / dist);
+            }
+        }
+    }
+}
+
+static void stressKernel(const double *__restrict__ pos,
+        const double *__restrict__ forces, const int *neighbors,
+        const signed char *crossings, const LeesEdwards &boundary,
+        double *__restrict__ sum)
+{
+    const int lanes = Replicas::lanes;
+
+    for (int n = 0; n < netSize * netSize; n++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            int m = neighbors[3 * n + k];
+            double lift = crossings[3 * n + k] * boundary.height;
+
+            const double *yn = pos + (2 * n + 1) * lanes;
+            const double *ym = pos + (2 * m + 1) * lanes;
+            const double *fx = forces + (6 * n + 2 * k) * lanes;
+
+            for (int l = 0; l < lanes; l++)
+                sum[l] += fx[l] * (ym[l] - yn[l] + lift);
+        }
+    }
+}
+
+// moveKernel moves the nodes of row i, as in Network::moveNodes, and adds
+// their nonaffinity to sqrdisp and sqrdispdd if accum is set.
+
+static void moveKernel(int i, const double *__restrict__ forces,
+        const double *__restrict__ kicks, double *__restrict__ pos,
+        double *__restrict__ delta, double affvel, double width, bool accum,
+        double *__restrict__ sqrdisp, double *__restrict__ sqrdispdd)
+{
+    const int lanes = Replicas::lanes;
+    double gamma = 4 * PI * ETA * RADIUS;
+    double affx = i / 2.0 + affdel * ((2.0 * i) / (netSize - 1.0) - 1.0);
+    double affy = sqrt(3.0) / 2.0 * i;
+    int i2 = i == 0 ? netSize - 1 : i - 1;
+
+    for (int j = 0; j < netSize; j++)
+    {
+        int n = i * netSize + j;
+        int j1 = j == netSize - 1 ? 0 : j + 1;
+        int j2 = j == 0 ? netSize - 1 : j - 1;
+
+        // The forces of the node's own bonds, and of the bonds that end on
+        // it, as in Network::moveNodes.
+        const double *f0 = forces + 6 * n * lanes;
+        const double *f1 = forces + 6 * (i * netSize + j2) * lanes;
+        const double *f2 = forces + (6 * (i2 * netSize + j) + 2) * lanes;
+        const double *f3 = forces + (6 * (i2 * netSize + j1) + 4) * lanes;
+
+        double *x = pos + 2 * n * lanes, *y = x + lanes;
+        double *dx = delta + 2 * n * lanes, *dy = dx + lanes;
+        const double *kx = kicks + 2 * j * lanes, *ky = kx + lanes;
+
+        for (int l = 0; l < lanes; l++)
+        {
+            double netx = f0[l] + f0[2 * lanes + l] + f0[4 * lanes + l]
+                - f1[l] - f2[l] - f3[l];
+            double nety = f0[lanes + l] + f0[3 * lanes + l] + f0[5 * lanes + l]
+                - f1[lanes + l] - f2[lanes + l] - f3[lanes + l];
+
+            dx[l] = TIMESTEP * (netx / gamma + affvel) + kx[l];
+            dy[l] = TIMESTEP * (nety / gamma) + ky[l];
+
+            double newx = x[l] + dx[l];
+            x[l] = newx >= 2.0 * width ? newx - width
+                : (newx < -width ? newx + width : newx);
+            y[l] += dy[l];
+        }
+
+        if (accum)
+        {
+            for (int l = 0; l < lanes; l++)
+            {
+                double ux = x[l] - (j + affx);
+                ux -= width * nearest(ux / width);
+                double uy = y[l] - affy;
+                double dvx = dx[l] / TIMESTEP - affvel;
+                double dvy = dy[l] / TIMESTEP;
+
+                sqrdisp[l] += ux * ux + uy * uy;
+                sqrdispdd[l] += dvx * dvx + dvy * dvy;
+            }
+        }
+    }
+}
+
+void Replicas::getNetForces()
+{
+    forceKernel(pos, spring, forces, neighbors, crossings, boundary);
+}
+
+void Replicas::calcStress()
+{
+    double sum[lanes];
+    double prefactor = 1 / (sqrt(3.0) / 2.0 * netSize * netSize);
+
+    for (int l = 0; l < lanes; l++)
+        sum[l] = 0.0;
+
+    stressKernel(pos, forces, neighbors, crossings, boundary, sum);
+
+    for (int l = 0; l < lanes; l++)
+        stress[l] = sum[l] * prefactor;
+}
+
+void Replicas::moveNodes(double shear_rate, double temp)
+{
+    double d = KB * temp / (6 * PI * ETA * RADIUS);
+    double sigma = sqrt(2 * d * TIMESTEP);
+
+    double affvel = affvx(netSize - 1, shear_rate);
+    affdel += affvel * TIMESTEP;
+    boundary.advance(affvel * TIMESTEP);
+
+    double sqrdisp[lanes], sqrdispdd[lanes];
+
+    for (int l = 0; l < lanes; l++)
+        sqrdisp[l] = sqrdispdd[l] = 0.0;
+
+    for (int i = 0; i < netSize; i++)
+    {
+        // The thermal kicks of the row are drawn first, replica by replica,
+        // so that the loops of the kernel stay free of calls.
+
+        for (int j = 0; j < netSize; j++)
+        {
+            for (int l = 0; l < lanes; l++)
+            {
+                if (temp > 1e-15)
+                {
+                    double theta = 2 * PI * noise[l]->randDblExc();
+                    double r = sigma * sqrt(-2 * log(noise[l]->randDblExc()));
+
+                    kicks[2 * j * lanes + l] = r * cos(theta);
+                    kicks[(2 * j + 1) * lanes + l] = r * sin(theta);
+                }
+                else
+                {
+                    kicks[2 * j * lanes + l] = 0.0;
+                    kicks[(2 * j + 1) * lanes + l] = 0.0;
+                }
+            }
+        }
+
+        moveKernel(i, forces, kicks, pos, delta, affvx(i, shear_rate),
+                boundary.width, accumNonAff, sqrdisp, sqrdispdd);
+    }
+
+    for (int l = 0; l < lanes; l++)
+    {
+        nonAff[l] = std::abs(affdel) < 1E-15 ? 0.0 : sqrdisp[l];
+        nonAffdd[l] = sqrdispdd[l];
+    }
+}
+
+// openReplicaFiles opens the file name_l.txt of every replica l.
+
+static void openReplicaFiles(OutFile *files, std::string root_path,
+        std::string name, int precision)
+{
+    for (int l = 0; l < Replicas::lanes; l++)
+    {
+        char suffix[16];
+        snprintf(suffix, sizeof(suffix), "_%d.txt", l);
+        files[l].open(root_path + "/" + name + suffix, "w");
+        files[l].precision = precision;
+    }
+}
+
+int integrateReplicas(const Options &opts, unsigned int seed, int nTimeSteps,
+        const Protocol &protocol, std::string root_path, int nonaff_steps)
+{
+    const int lanes = Replicas::lanes;
+
+    if (!opts.posFileName.empty() || !opts.energyFileName.empty()
+            || !opts.renderFileName.empty())
+        printf("Position, energy and rendered output are not written in"
+               " replica mode.\n");
+
+    printf("Integrating %d replicas with seeds %u to %u.\n", lanes, seed,
+            seed + lanes - 1);
+
+    Replicas replicas(opts.pBond, seed);
+
+    OutFile stressFiles[lanes], nonaffFiles[lanes];
+    bool printStress = !opts.stressFileName.empty();
+    bool printNonAff = !opts.nonaffFileName.empty();
+
+    if (printStress)
+        openReplicaFiles(stressFiles, root_path, opts.stressFileName, opts.precision);
+
+    if (printNonAff)
+    {
+        openReplicaFiles(nonaffFiles, root_path, opts.nonaffFileName, opts.precision);
+
+        for (int l = 0; l < lanes; l++)
+            nonaffFiles[l] << opts.pBond << "," << netSize << "," << TIMESTEP << "\n";
+    }
+
+    // integrator-top follows the first replica (see status.h).
+
+    Telemetry telemetry(opts.status_dir, root_path, nTimeSteps, frame_sep);
+    double lastNonAff = 0.0, lastNonAffdd = 0.0;
+
+    for (int i = 0; i < nTimeSteps; i++)
+    {
+        double strain = affdel * 2 / (sqrt(3.0) / 2.0 * netSize);
+
+        replicas.getNetForces();
+        replicas.calcStress();
+
+        for (int l = 0; l < lanes; l++)
+        {
+            if (replicas.stress[l] != replicas.stress[l])
+            {
+                printf("Stress of replica %d (seed %u) has gone to NaN.\n", l, seed + l);
+                printf("p = %.2g, w = %.4g, N = %d, e = %.2g\n", opts.pBond,
+                        opts.strRate, netSize, opts.initStrain);
+                return 2;
+            }
+        }
+
+        if (printNonAff && i > 0 && i % nonaff_steps == 0)
+        {
+            for (int l = 0; l < lanes; l++)
+                nonaffFiles[l] << i * TIMESTEP << "," << affdel << ","
+                    << replicas.nonAff[l] << "," << protocol.rate(i - 1) << ","
+                    << replicas.nonAffdd[l] << "\n";
+
+            lastNonAff = replicas.nonAff[0];
+            lastNonAffdd = replicas.nonAffdd[0];
+        }
+
+        if (i % frame_sep == 0)
+        {
+            printf("/");
+            fflush(stdout);
+
+            for (int l = 0; l < lanes && printStress; l++)
+            {
+                stressFiles[l] << replicas.stress[l] << "," << strain << ",";
+                stressFiles[l].put(i * TIMESTEP, 0);
+                stressFiles[l] << "\n";
+                stressFiles[l].flush();
+            }
+
+            for (int l = 0; l < lanes && printNonAff; l++)
+                nonaffFiles[l].flush();
+
+            telemetry.update(i, affdel, strain, replicas.stress[0], lastNonAff,
+                    lastNonAffdd, 1);
+        }
+
+        replicas.accumNonAff = printNonAff && (i + 1) % nonaff_steps == 0;
+        replicas.moveNodes(protocol.rate(i), opts.temp);
+    }
+
+    printf("\n");
+
+    return 0;
+}
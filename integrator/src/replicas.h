@@ -0,0 +1,83 @@
+#ifndef REPLICAS_H_
+#define REPLICAS_H_
+
+// replicas.h
+// ----------
+//
+// replicas.h defines the struct Replicas, which integrates several
+// independent copies (replicas) of the network in lockstep. Every replica has
+// its own springs and its own thermal noise, but all of them are sheared
+// alike, so they share the boundary and the neighbor tables.
+//
+// The replicas are stored interleaved: every array holds lanes values for
+// each entry, one per replica, e.g. the x coordinate of node n in replica l
+// is pos[2 * n * lanes + l] and its y coordinate pos[(2 * n + 1) * lanes + l].
+// The innermost loop of every kernel runs over the replicas, with the same
+// neighbor and the same operations for all of them, so it maps straight onto
+// the SIMD lanes of the processor. A SIMD register holds 2 doubles with SSE2
+// (the default on x86-64), 4 with AVX2 and 8 with AVX-512; the wider
+// instructions need -march=native (make NATIVE=1). lanes is 4 by default,
+// which fills AVX2. With SSE2, each operation then takes two registers, and a
+// replica costs no more than with 2 lanes. Set it with -DREPLICA_LANES=n. It
+// is also the number of replicas of a run.
+//
+// Replica l draws its springs with srand(seed + l) exactly as the integrator
+// does, so at zero temperature it follows the same trajectory as a serial
+// run with --prng seed + l. Its thermal noise comes from its own Mersenne
+// Twister, seeded with seed + l.
+
+#include <string>
+#include "network.h"
+#include "leesedwards.h"
+#include "options.h"
+#include "protocol.h"
+
+#ifndef REPLICA_LANES
+#define REPLICA_LANES 4
+#endif
+
+class MTRand;
+
+extern double TIMESTEP;
+extern int frame_sep;
+
+struct Replicas {
+
+    enum {lanes = REPLICA_LANES};
+
+    double *pos;        // [2 * netSize * netSize * lanes]
+    double *delta;      // [2 * netSize * netSize * lanes]
+    double *spring;     // [3 * netSize * netSize * lanes]
+    double *forces;     // [6 * netSize * netSize * lanes], as in Network
+
+    LeesEdwards boundary;
+    int *neighbors;
+    signed char *crossings;
+
+    bool accumNonAff;
+    double stress[lanes], nonAff[lanes], nonAffdd[lanes];
+
+    Replicas(double pBond, unsigned int seed);
+    ~Replicas();
+
+    // The kernels do the same as those of Network for every replica.
+    // calcStress sets stress.
+    void getNetForces();
+    void calcStress();
+    void moveNodes(double shear_rate, double temp);
+
+    private:
+
+    MTRand *noise[lanes];
+    double *kicks;      // Thermal displacements of one row of nodes
+
+};
+
+// integrateReplicas runs the simulation of integrator.cpp for Replicas::lanes
+// replicas, writing the stress and nonaffinity of replica l to the files of
+// the options with "_l" appended to their names. It returns the exit status
+// of the integrator.
+int integrateReplicas(const Options &opts, unsigned int seed, int nTimeSteps,
+        const Protocol &protocol, std::string root_path, int nonaff_steps);
+
+#endif /* REPLICAS_H_ */
@@ -0,0 +1,411 @@
+// response.cpp
+// ------------
+//
+// response.cpp implements the linear-response mode of response.h.
+
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include "response.h"
+#include "network.h"
+#include "print.h"
+
+// Relative residual at which a frequency is solved, and the most iterations
+// spent on it.
+
+static const double tolerance = 1e-10;
+static const int max_iterations = 100000;
+
+Stiffness::Stiffness(double ***spring) :
+    nodes(netSize * netSize),
+    affineModulus(0.0),
+    drag(4 * PI * ETA * RADIUS)
+{
+    std::vector<int> neighbors(3 * nodes);
+    std::vector<signed char> crossings(3 * nodes);
+    buildNeighborTables(&neighbors[0], &crossings[0]);
+
+    LeesEdwards boundary;
+
+    // The blocks of a node couple it to itself (first) and to the nodes it
+    // shares a spring with. On small lattices two bonds may join the same
+    // nodes, so every column is listed once.
+
+    std::vector<std::vector<int> > columns(nodes);
+
+    for (int n = 0; n < nodes; n++)
+        columns[n].push_back(n);
+
+    for (int n = 0; n < nodes; n++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            int m = neighbors[3 * n + k];
+
+            if (spring[n / netSize][n % netSize][k] == 0 || m == n)
+                continue;
+
+            std::vector<int> &a = columns[n], &b = columns[m];
+
+            if (std::find(a.begin(), a.end(), m) == a.end())
+                a.push_back(m);
+            if (std::find(b.begin(), b.end(), n) == b.end())
+                b.push_back(n);
+        }
+    }
+
+    start.resize(nodes + 1);
+    start[0] = 0;
+
+    for (int n = 0; n < nodes; n++)
+    {
+        start[n + 1] = start[n] + columns[n].size();
+        column.insert(column.end(), columns[n].begin(), columns[n].end());
+    }
+
+    block.assign(4 * start[nodes], 0.0);
+    affine.assign(2 * nodes, 0.0);
+
+    double c = 0.0;
+
+    for (int n = 0; n < nodes; n++)
+    {
+        int i = n / netSize, j = n % netSize;
+
+        for (int k = 0; k < 3; k++)
+        {
+            int m = neighbors[3 * n + k];
+            double s = spring[i][j][k] / RESTLEN;
+
+            if (s == 0 || m == n)
+                continue;
+
+            int mi = m / netSize, mj = m % netSize;
+            double dx = boundary.dx(RESTLEN * (mi / 2.0 + mj - i / 2.0 - j),
+                    crossings[3 * n + k]);
+            double dy = boundary.dy(sqrt(3) / 2 * RESTLEN * (mi - i),
+                    crossings[3 * n + k]);
+            double length = sqrt(dx * dx + dy * dy);
+            double ex = dx / length, ey = dy / length;
+            double kb[4] = {s * ex * ex, s * ex * ey, s * ey * ex, s * ey * ey};
+
+            // K gets the bond stiffness on the diagonal blocks of both nodes,
+            // and minus it where they couple.
+
+            for (int side = 0; side < 2; side++)
+            {
+                int a = side == 0 ? n : m, b = side == 0 ? m : n;
+
+                for (int e = start[a]; e < start[a + 1]; e++)
+                {
+                    if (column[e] == a)
+                        for (int l = 0; l < 4; l++)
+                            block[4 * e + l] += kb[l];
+                    else if (column[e] == b)
+                        for (int l = 0; l < 4; l++)
+                            block[4 * e + l] -= kb[l];
+                }
+            }
+
+            // A unit affine strain stretches the bond by ex dy.
+
+            double g = s * ex * dy;
+
+            affine[2 * m] += g * ex;
+            affine[2 * m + 1] += g * ey;
+            affine[2 * n] -= g * ex;
+            affine[2 * n + 1] -= g * ey;
+            c += g * ex * dy;
+        }
+    }
+
+    affineModulus = c / (sqrt(3.0) / 2.0 * netSize * netSize);
+}
+
+void Stiffness::multiply(const Complex *x, Complex shift, Complex *y) const
+{
+    for (int n = 0; n < nodes; n++)
+    {
+        Complex yx = shift * x[2 * n], yy = shift * x[2 * n + 1];
+
+        for (int b = start[n]; b < start[n + 1]; b++)
+        {
+            const double *B = &block[4 * b];
+            int m = column[b];
+
+            yx += B[0] * x[2 * m] + B[1] * x[2 * m + 1];
+            yy += B[2] * x[2 * m] + B[3] * x[2 * m + 1];
+        }
+
+        y[2 * n] = yx;
+        y[2 * n + 1] = yy;
+    }
+}
+
+// dot returns the bilinear (unconjugated) product of a and b, under which
+// the shifted K is symmetric.
+
+static Complex dot(const std::vector<Complex> &a, const std::vector<Complex> &b)
+{
+    Complex sum = 0.0;
+
+    for (size_t l = 0; l < a.size(); l++)
+        sum += a[l] * b[l];
+
+    return sum;
+}
+
+static double norm(const std::vector<Complex> &a)
+{
+    double sum = 0.0;
+
+    for (size_t l = 0; l < a.size(); l++)
+        sum += std::norm(a[l]);
+
+    return sqrt(sum);
+}
+
+// setModulus sets G' and G'' of result from f.u, per unit of the strain of
+// the stress files (see response.h).
+
+static void setModulus(const Stiffness &K, Complex fu, Response &result)
+{
+    Complex modulus = (K.affineModulus + fu / (sqrt(3.0) / 2.0 * netSize * netSize))
+        * (netSize / (netSize - 1.0));
+
+    result.storage = modulus.real();
+    result.loss = modulus.imag();
+}
+
+Response respond(const Stiffness &K, double w, double tol, int maxIterations)
+{
+    int size = 2 * K.nodes;
+    Complex shift(0.0, w * K.drag);
+
+    // The preconditioner is the inverse of the shifted diagonal blocks. The
+    // diagonal block of every node is its first.
+
+    std::vector<Complex> inverse(4 * K.nodes);
+
+    for (int n = 0; n < K.nodes; n++)
+    {
+        const double *B = &K.block[4 * K.start[n]];
+        Complex a = B[0] + shift, b = B[1], c = B[2], d = B[3] + shift;
+        Complex det = a * d - b * c;
+
+        inverse[4 * n] = d / det;
+        inverse[4 * n + 1] = -b / det;
+        inverse[4 * n + 2] = -c / det;
+        inverse[4 * n + 3] = a / det;
+    }
+
+    std::vector<Complex> x(size, 0.0), r(size), z(size), p(size), q(size);
+
+    for (int l = 0; l < size; l++)
+        r[l] = -K.affine[l];
+
+    double target = tol * norm(r);
+    Response result;
+    result.iterations = 0;
+    result.converged = norm(r) <= target;
+
+    // Conjugate orthogonal conjugate gradients: CG with the bilinear product.
+
+    Complex rho = 0.0;
+
+    for (int it = 0; it < maxIterations && !result.converged; it++)
+    {
+        for (int n = 0; n < K.nodes; n++)
+        {
+            const Complex *M = &inverse[4 * n];
+            z[2 * n] = M[0] * r[2 * n] + M[1] * r[2 * n + 1];
+            z[2 * n + 1] = M[2] * r[2 * n] + M[3] * r[2 * n + 1];
+        }
+
+        Complex rhoNext = dot(r, z);
+        Complex beta = it == 0 ? 0.0 : rhoNext / rho;
+        rho = rhoNext;
+
+        for (int l = 0; l < size; l++)
+            p[l] = z[l] + beta * p[l];
+
+        K.multiply(&p[0], shift, &q[0]);
+
+        Complex alpha = rho / dot(p, q);
+
+        for (int l = 0; l < size; l++)
+        {
+            x[l] += alpha * p[l];
+            r[l] -= alpha * q[l];
+        }
+
+        result.iterations = it + 1;
+        result.converged = norm(r) <= target;
+    }
+
+    Complex fu = 0.0;
+
+    for (int l = 0; l < size; l++)
+        fu += K.affine[l] * x[l];
+
+    setModulus(K, fu, result);
+
+    return result;
+}
+
+std::vector<Response> respondAll(const Stiffness &K, const std::vector<double> &w,
+        double tol, int maxIterations)
+{
+    int size = 2 * K.nodes, shifts = w.size();
+    std::vector<Response> results(shifts);
+
+    if (shifts == 0)
+        return results;
+
+    // The seed system is that of the lowest frequency, and the others are
+    // shifted from it by sigma.
+
+    double lowest = *std::min_element(w.begin(), w.end());
+    Complex seed(0.0, lowest * K.drag);
+
+    std::vector<Complex> r(size), p(size), q(size);
+
+    for (int l = 0; l < size; l++)
+        r[l] = p[l] = -K.affine[l];
+
+    double target = tol * norm(r);
+    Complex rho = dot(r, r);
+    Complex fr = -rho;          // f.r, as r = -f
+    Complex alphaLast = 1.0, betaLast = 0.0;
+
+    // The residual of shift j is zeta[j] times that of the seed. fp and fu
+    // are f.p and f.u of its system; its own p and u are never formed.
+
+    std::vector<Complex> sigma(shifts), zeta(shifts, 1.0), zetaLast(shifts, 1.0),
+        zetaNext(shifts), fp(shifts, fr), fu(shifts, 0.0);
+
+    int remaining = 0;
+
+    for (int j = 0; j < shifts; j++)
+    {
+        sigma[j] = Complex(0.0, (w[j] - lowest) * K.drag);
+        results[j].iterations = 0;
+        results[j].converged = norm(r) <= target;
+
+        if (!results[j].converged)
+            remaining++;
+    }
+
+    for (int it = 0; it < maxIterations && remaining > 0; it++)
+    {
+        K.multiply(&p[0], seed, &q[0]);
+
+        Complex alpha = rho / dot(p, q);
+
+        for (int j = 0; j < shifts; j++)
+        {
+            if (results[j].converged)
+                continue;
+
+            zetaNext[j] = zeta[j] * zetaLast[j] * alphaLast
+                / (alpha * betaLast * (zetaLast[j] - zeta[j])
+                        + zetaLast[j] * alphaLast * (1.0 + sigma[j] * alpha));
+            fu[j] += alpha * zetaNext[j] / zeta[j] * fp[j];
+        }
+
+        for (int l = 0; l < size; l++)
+            r[l] -= alpha * q[l];
+
+        Complex rhoNext = dot(r, r);
+        Complex beta = rhoNext / rho;
+
+        fr = 0.0;
+
+        for (int l = 0; l < size; l++)
+        {
+            fr += K.affine[l] * r[l];
+            p[l] = r[l] + beta * p[l];
+        }
+
+        double residual = norm(r);
+
+        for (int j = 0; j < shifts; j++)
+        {
+            if (results[j].converged)
+                continue;
+
+            Complex ratio = zetaNext[j] / zeta[j];
+            fp[j] = zetaNext[j] * fr + beta * ratio * ratio * fp[j];
+            zetaLast[j] = zeta[j];
+            zeta[j] = zetaNext[j];
+
+            results[j].iterations = it + 1;
+            results[j].converged = std::abs(zeta[j]) * residual <= target;
+
+            if (results[j].converged)
+                remaining--;
+        }
+
+        alphaLast = alpha;
+        betaLast = beta;
+        rho = rhoNext;
+    }
+
+    for (int j = 0; j < shifts; j++)
+        setModulus(K, fu[j], results[j]);
+
+    return results;
+}
+
+int linearResponse(const Options &opts, double ***spring, std::string root_path)
+{
+    Stiffness K(spring);
+
+    printf("Linear response of %d nodes with %d blocks of K.\n", K.nodes,
+            K.start[K.nodes]);
+
+    OutFile file;
+    file.precision = opts.precision;
+
+    if (!opts.responseFileName.empty())
+        file.open(root_path + "/" + opts.responseFileName + ".txt", "w");
+
+    printf("w,G',G'',tan_delta,iterations\n");
+
+    std::vector<Response> results = respondAll(K, opts.response, tolerance,
+            max_iterations);
+    int products = 0, status = 0;
+
+    for (size_t f = 0; f < opts.response.size(); f++)
+    {
+        double w = opts.response[f];
+        Response &r = results[f];
+
+        products = std::max(products, r.iterations);
+
+        if (!r.converged)
+        {
+            printf("Multi-shift COCG did not converge at w = %g; solving it alone.\n", w);
+            r = respond(K, w, tolerance, max_iterations);
+            products += r.iterations;
+        }
+
+        printf("%.6g,%.6g,%.6g,%.6g,%d\n", w, r.storage, r.loss,
+                r.loss / r.storage, r.iterations);
+
+        if (!r.converged)
+        {
+            printf("COCG did not converge at w = %g in %d iterations.\n", w,
+                    r.iterations);
+            status = 2;
+        }
+
+        if (file.is_open())
+            file << w << "," << r.storage << "," << r.loss << "\n";
+    }
+
+    printf("Solved %d frequencies with %d products with K.\n",
+            (int) opts.response.size(), products);
+
+    return status;
+}
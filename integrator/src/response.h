@@ -0,0 +1,99 @@
+#ifndef RESPONSE_H_
+#define RESPONSE_H_
+
+// response.h
+// ----------
+//
+// response.h declares the linear-response mode of the integrator
+// (--response w1 w2 ...), which finds the complex shear modulus G*(ω) of the
+// network without integrating it in time.
+//
+// For small strains the overdamped network obeys
+//
+//   γ du/dt = -K u - ε(t) f
+//
+// where u is the nonaffine displacement of the nodes, K the stiffness matrix
+// of the springs at rest, γ = 4π η a the drag of a node (as in moveRow), ε
+// the shear strain and f the force that a unit affine strain puts on each
+// node. The stress is σ = (ε c + f·u) / A, where c = Σ k (e_x r_y)^2 over
+// the bonds is the affine part and A the area of the network. For
+// ε = e^{iωt}, u = û e^{iωt} with
+//
+//   (K + iωγ) û = -f
+//
+// and G*(ω) = (c + f·û) / A. K is complex symmetric once shifted, and a
+// frequency can be solved on its own with the conjugate orthogonal conjugate
+// gradient method (COCG), preconditioned with the inverse 2x2 diagonal
+// blocks.
+//
+// The systems of all frequencies differ only by a multiple of the identity,
+// so they share one Krylov space, and a whole sweep is solved at once by
+// multi-shift COCG: the system of the lowest frequency (the slowest) is
+// iterated, and the solutions of the others follow from its residuals with a
+// few scalar recurrences per frequency. Only f·û is needed, and that too
+// follows from scalars, so a sweep costs one product with K per iteration
+// however many frequencies it has. A preconditioner would break the shift
+// invariance, so this iteration is not preconditioned; frequencies it fails
+// to solve are solved again on their own.
+//
+// Like analyze.out on the stress files of a time integration, G* is given
+// per unit of the strain written in those files, which is (netSize - 1) /
+// netSize of the shear of the boundary. The springs are drawn exactly as for
+// a time integration with the same seed, so the two can be compared; for
+// small strains they agree up to the transient that analyze.out skips.
+//
+// The network is linearized about its rest state, so motors (which
+// prestress it) and hydrodynamic interactions are not supported.
+
+#include <complex>
+#include <string>
+#include <vector>
+#include "options.h"
+
+typedef std::complex<double> Complex;
+
+// Stiffness is the stiffness matrix K of the lattice at rest, stored in
+// block compressed sparse row form: the 2x2 blocks of node n are start[n] to
+// start[n + 1] - 1, block b coupling n to node column[b], with its entries
+// block[4 * b] to block[4 * b + 3] in row-major order.
+struct Stiffness {
+
+    int nodes;
+    std::vector<int> start, column;
+    std::vector<double> block;
+    std::vector<double> affine; // f, 2 per node
+    double affineModulus;       // c / A, G* at infinite frequency
+    double drag;                // γ
+
+    // Stiffness assembles K for the springs of a netSize by netSize lattice.
+    Stiffness(double ***spring);
+
+    // multiply sets y = (K + shift) x.
+    void multiply(const Complex *x, Complex shift, Complex *y) const;
+
+};
+
+struct Response {
+
+    double storage, loss;   // G' and G''
+    int iterations;         // COCG iterations used
+    bool converged;
+
+};
+
+// respond returns G*(w) of the network with stiffness K, solving to a
+// relative residual of tol in at most maxIterations iterations.
+Response respond(const Stiffness &K, double w, double tol, int maxIterations);
+
+// respondAll returns G* at every frequency of w from a single multi-shift
+// COCG iteration. The iterations of each response are those it took to
+// converge, all sharing the same products with K.
+std::vector<Response> respondAll(const Stiffness &K, const std::vector<double> &w,
+        double tol, int maxIterations);
+
+// linearResponse runs the linear-response mode for the frequencies of
+// opts.response, printing G' and G'' and writing them to the response file
+// if one is set. It returns the exit status of the integrator.
+int linearResponse(const Options &opts, double ***spring, std::string root_path);
+
+#endif /* RESPONSE_H_ */
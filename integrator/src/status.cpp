@@ -0,0 +1,134 @@
+// status.cpp
+// ----------
+//
+// status.cpp implements Telemetry, the writer of the status record of
+// status.h.
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "status.h"
+
+extern int netSize;
+extern double TIMESTEP;
+
+static double wallClock()
+{
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+Telemetry::Telemetry(std::string dir, std::string label, int nTimeSteps,
+        int frameSteps) :
+    page(NULL),
+    lastStep(0),
+    lastTime(wallClock())
+{
+    if (dir.empty())
+        return;
+
+    path = statusPath(dir, getpid());
+
+    // The record is written under a temporary name and renamed into place,
+    // so integrator-top never sees a file that is only partly created.
+
+    std::string temporary = path + ".new";
+    int fd = open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0 || ftruncate(fd, sizeof(StatusPage)) != 0)
+    {
+        printf("Couldn't create the status file %s.\n", path.c_str());
+
+        if (fd >= 0)
+        {
+            close(fd);
+            unlink(temporary.c_str());
+        }
+
+        return;
+    }
+
+    void *mem = mmap(NULL, sizeof(StatusPage), PROT_READ | PROT_WRITE,
+            MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mem == MAP_FAILED)
+    {
+        unlink(temporary.c_str());
+        return;
+    }
+
+    // The file is new and zero, so the sequence starts out even.
+
+    page = static_cast<StatusPage *>(mem);
+
+    StatusData &data = page->data;
+    data.pid = getpid();
+    data.netSize = netSize;
+    data.nTimeSteps = nTimeSteps;
+    data.frameSteps = frameSteps;
+    data.substeps = 1;
+    data.timestep = TIMESTEP;
+    data.started = data.updated = lastTime;
+    data.eta = -1.0;
+    strncpy(data.label, label.c_str(), sizeof(data.label) - 1);
+    data.version = StatusData::version_value;
+
+    std::atomic_thread_fence(std::memory_order_release);
+    data.magic = StatusData::magic_value;
+
+    if (rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        printf("Couldn't create the status file %s.\n", path.c_str());
+        munmap(page, sizeof(StatusPage));
+        unlink(temporary.c_str());
+        page = NULL;
+    }
+}
+
+Telemetry::~Telemetry()
+{
+    if (page == NULL)
+        return;
+
+    munmap(page, sizeof(StatusPage));
+    unlink(path.c_str());
+}
+
+void Telemetry::update(int step, double affdel, double strain, double stress,
+        double nonaff, double nonaffdd, int substeps)
+{
+    if (page == NULL)
+        return;
+
+    double now = wallClock();
+    double rate = step > lastStep && now > lastTime
+        ? (step - lastStep) / (now - lastTime) : page->data.stepsPerSecond;
+
+    unsigned sequence = page->sequence.load(std::memory_order_relaxed);
+    page->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    StatusData &data = page->data;
+    data.step = step;
+    data.substeps = substeps;
+    data.updated = now;
+    data.time = step * TIMESTEP;
+    data.affdel = affdel;
+    data.strain = strain;
+    data.stress = stress;
+    data.nonaff = nonaff;
+    data.nonaffdd = nonaffdd;
+    data.stepsPerSecond = rate;
+    data.eta = rate > 0 ? (data.nTimeSteps - step) / rate : -1.0;
+
+    page->sequence.store(sequence + 2, std::memory_order_release);
+
+    lastStep = step;
+    lastTime = now;
+}
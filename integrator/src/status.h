@@ -0,0 +1,105 @@
+#ifndef STATUS_H_
+#define STATUS_H_
+
+// status.h
+// --------
+//
+// status.h defines the status record that a running integrator publishes
+// for integrator-top (see top.cpp). The first process of every run maps a
+// small file, integrator-<pid>.status in the status directory (--status-dir,
+// /dev/shm by default, i.e. memory), and rewrites the record at every frame:
+// the step, the simulated time, affdel, the latest stress and nonaffinity,
+// the speed and the estimated time left. The file is removed when the run
+// ends, so the directory lists the runs of the machine.
+//
+// Graph runs (--graph) publish the shear of their box as affdel, and replica
+// runs (--replicas) the state of their first replica. The linear-response
+// mode (--response) takes no time steps, so it publishes nothing.
+//
+// The record is guarded by a sequence lock: the writer makes the sequence
+// number odd, writes the data and makes it even again, and a reader copies
+// the data and retries if the number was odd or changed meanwhile. Readers
+// never block the integrator, which only pays for a copy per frame.
+
+#include <atomic>
+#include <string>
+
+struct StatusData {
+
+    enum {magic_value = 0x5354494e, version_value = 1};
+
+    unsigned magic, version;
+    int pid;
+    int netSize, nTimeSteps, frameSteps;
+    int step;
+    int substeps;           // Substeps per step of the health monitor
+    double timestep;
+    double started;         // Wall-clock time of the start, in seconds
+    double updated;         // Wall-clock time of the last update
+    double time;            // Simulated time
+    double affdel, strain, stress;
+    double nonaff, nonaffdd; // Latest sample, or 0 before the first
+    double stepsPerSecond;  // Over the last frame
+    double eta;             // Seconds left at that speed
+    char label[256];        // Output path of the run
+
+};
+
+struct StatusPage {
+
+    std::atomic<unsigned> sequence;
+    StatusData data;
+
+};
+
+// readStatus copies the record of page to data, retrying while it is being
+// written. It returns false if the page doesn't hold a record of this
+// version.
+inline bool readStatus(const StatusPage *page, StatusData &data)
+{
+    for (int tries = 0; tries < 1000; tries++)
+    {
+        unsigned before = page->sequence.load(std::memory_order_acquire);
+
+        if (before & 1)
+            continue;
+
+        data = page->data;
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (page->sequence.load(std::memory_order_relaxed) == before)
+            return data.magic == StatusData::magic_value
+                && data.version == StatusData::version_value;
+    }
+
+    return false;
+}
+
+// Telemetry publishes the status of the integrator.
+struct Telemetry {
+
+    // Telemetry creates the status file in dir; with an empty dir, or if the
+    // file can't be created, update does nothing.
+    Telemetry(std::string dir, std::string label, int nTimeSteps, int frameSteps);
+    ~Telemetry();
+
+    // update publishes the state of the run at step.
+    void update(int step, double affdel, double strain, double stress,
+            double nonaff, double nonaffdd, int substeps);
+
+    private:
+
+    std::string path;
+    StatusPage *page;
+    int lastStep;
+    double lastTime;
+
+};
+
+// statusPath returns the name of the status file of process pid in dir.
+inline std::string statusPath(std::string dir, int pid)
+{
+    return dir + "/integrator-" + std::to_string(pid) + ".status";
+}
+
+#endif /* STATUS_H_ */
@@ -0,0 +1,1014 @@
+/* sweep.cpp
+ * ---------
+ *
+ * sweep.cpp runs a parameter sweep of the integrator described by a sweep
+ * manifest. The manifest lists the values of every swept parameter, the PRNG
+ * seeds and the number of replicas; the sweep is the product of all of them.
+ * Every run (task) gets its own output directory, and the tasks are run by a
+ * pool of worker processes on the local machine.
+ *
+ * Finished tasks are recorded in a ledger in the output directory. When a
+ * sweep is started again, e.g. after it was interrupted, the tasks that
+ * finished successfully are skipped, so the sweep resumes where it left off.
+ *
+ * Usage: sweep.out manifest [--workers n] [--dry-run]
+ *
+ * The manifest has one setting per line, "key = value", and # starts a
+ * comment:
+ *
+ *   program = ./integrator.out        Integrator to run (integrator.out next
+ *                                     to sweep.out)
+ *   config = stressconf               Integrator config file, passed with -c
+ *   output = /data/sweep              Root directory of the sweep (required)
+ *   layout = p{probability}/e{strain}/s{seed}
+ *                                     Directory of a task below output; {name}
+ *                                     is replaced by the value of the axis
+ *                                     name, {seed} by the seed of the task
+ *                                     (default: one level per axis and the
+ *                                     seed, e.g. probability_0.8/seed_1)
+ *   args = -t 0.01 -z 64              Extra integrator arguments for all tasks
+ *   seeds = 1 2 3                     Base PRNG seeds (1)
+ *   replicas = 4                      Replicas per base seed (1); replica r
+ *                                     of seed s runs with seed s + r * stride
+ *   seed-stride = 1000                (1000)
+ *   workers = 4                       Number of simultaneous tasks (1)
+ *   axis probability = 0.9 0.8 0.7    A swept integrator option, given as a
+ *   axis strain = 0.01:0.09:0.01      list of values or as first:last:step
+ *   measure = ./analyze.out -a nonaff.txt {dir}/stress.txt
+ *                                     Command run after every task (see below)
+ *   observables = G' G''              Measured values that set the ensemble
+ *                                     size (all of them)
+ *   precision = 0.05                  Wanted half-width of the confidence
+ *                                     interval, relative to the mean (0.05)
+ *   tolerance = 1e-4                  ... or absolute, if that is wider (0)
+ *   max-replicas = 40                 Most replicas per base seed (replicas)
+ *
+ * The ledger (ledger.txt in the output directory) has one line per finished
+ * task: "done" or "failed:<status>", the run time in seconds, the directory
+ * of the task and the values measured for it. Failed tasks are run again
+ * when the sweep resumes.
+ *
+ * Ensembles. The tasks that differ only in their seed form the ensemble of a
+ * parameter point. When measure is given, it is run by the shell after each
+ * task that succeeds, with {dir} replaced by the directory of the task. It
+ * must print a table with a header line, like analyze.out; every numeric
+ * column of its last line is a sample of the value named in the header. The
+ * driver keeps the mean and variance of every value of every point (with
+ * Welford's update, as the samples arrive), and writes the mean, standard
+ * error and 95% confidence interval of each to ensemble.txt in the output
+ * directory.
+ *
+ * With max-replicas above replicas the ensembles are sized adaptively: every
+ * point starts with replicas replicas of each seed, and once they are done,
+ * a point whose confidence interval of some observable is still wider than
+ * the target gets more, as many as the variance so far says it needs (at
+ * most twice as many as it has). Points in the rigid phase then stop early,
+ * while those near the rigidity threshold, whose moduli vary much more from
+ * one network to the next, get up to max-replicas.
+ */
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <cerrno>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <boost/program_options.hpp>
+
+namespace po = boost::program_options;
+
+struct Axis {
+
+    std::string name;                   // Long name of the integrator option
+    std::vector<std::string> values;
+
+};
+
+struct Manifest {
+
+    std::string program, config, output, layout, args, measure;
+    std::vector<int> seeds;
+    int replicas, seedStride, workers, maxReplicas;
+    std::vector<Axis> axes;
+    std::vector<std::string> observables;
+    double precision, tolerance;
+
+    Manifest() : replicas(1), seedStride(1000), workers(1), maxReplicas(0),
+        precision(0.05), tolerance(0.0) {}
+
+    // read reads the manifest and returns 0, or prints an error and
+    // returns 1.
+    int read(std::string fileName);
+
+};
+
+struct Task {
+
+    std::string dir;                    // Output directory below the root
+    std::vector<std::string> args;      // Arguments of the integrator
+    size_t point;                       // Parameter point of the task
+
+};
+
+// Stats keeps the mean and variance of a stream of samples with Welford's
+// update, which does not lose precision when the variance is small compared
+// to the mean.
+struct Stats {
+
+    int n;
+    double mean, m2;    // m2 is the sum of squared deviations from the mean
+
+    Stats() : n(0), mean(0.0), m2(0.0) {}
+
+    void add(double x) {
+        n++;
+        double delta = x - mean;
+        mean += delta / n;
+        m2 += delta * (x - mean);
+    }
+
+    double variance() const { return n > 1 ? m2 / (n - 1) : 0.0; }
+    double error() const { return n > 0 ? sqrt(variance() / n) : 0.0; }
+
+    // halfWidth is the half-width of the 95% confidence interval of the mean.
+    double halfWidth() const;
+
+};
+
+struct Point {
+
+    std::vector<size_t> index;          // Value of each axis
+    int replicas;                       // Replicas per seed scheduled so far
+    int pending;                        // Tasks scheduled but not finished
+    int failed;                         // Tasks that failed in this run
+    std::map<std::string, Stats> stats;
+
+    Point() : replicas(0), pending(0), failed(0) {}
+
+};
+
+// The done tasks of the ledger, with the values measured for them.
+typedef std::map<std::string, std::map<std::string, double> > Ledger;
+
+// tQuantile returns the 97.5% quantile of Student's t distribution with nu
+// degrees of freedom: tabulated up to 4, and from its expansion about the
+// normal quantile (within 0.2%) above.
+
+static double tQuantile(int nu)
+{
+    const double table[4] = {12.706, 4.303, 3.182, 2.776};
+    const double z = 1.959964;
+    double z3 = z * z * z, z5 = z3 * z * z, z7 = z5 * z * z;
+
+    if (nu <= 4)
+        return table[nu - 1];
+
+    return z + (z3 + z) / (4.0 * nu) + (5 * z5 + 16 * z3 + 3 * z) / (96.0 * nu * nu)
+        + (3 * z7 + 19 * z5 + 17 * z3 - 15 * z) / (384.0 * nu * nu * nu);
+}
+
+double Stats::halfWidth() const
+{
+    return n > 1 ? tQuantile(n - 1) * error() : INFINITY;
+}
+
+static std::string trim(std::string str)
+{
+    size_t first = str.find_first_not_of(" \t\r");
+    if (first == std::string::npos)
+        return "";
+
+    size_t last = str.find_last_not_of(" \t\r");
+    return str.substr(first, last - first + 1);
+}
+
+static std::vector<std::string> split(std::string str)
+{
+    std::vector<std::string> words;
+    std::istringstream in(str);
+    std::string word;
+
+    while (in >> word)
+        words.push_back(word);
+
+    return words;
+}
+
+// parseValues expands the values of an axis: either a list of values, which
+// are kept as written, or a range first:last:step including both ends.
+
+static int parseValues(std::string text, std::vector<std::string> &values)
+{
+    std::vector<std::string> words = split(text);
+
+    if (words.size() == 1 && std::count(words[0].begin(), words[0].end(), ':') == 2)
+    {
+        double first, last, step;
+
+        if (sscanf(words[0].c_str(), "%lf:%lf:%lf", &first, &last, &step) != 3
+                || step == 0.0 || (last - first) / step < 0.0)
+            return 1;
+
+        int n = (int) floor((last - first) / step + 1e-9);
+
+        for (int k = 0; k <= n; k++)
+        {
+            char value[32];
+            snprintf(value, sizeof(value), "%.10g", first + k * step);
+            values.push_back(value);
+        }
+
+        return 0;
+    }
+
+    values = words;
+    return values.empty() ? 1 : 0;
+}
+
+int Manifest::read(std::string fileName)
+{
+    std::ifstream in(fileName.c_str());
+
+    if (!in)
+    {
+        std::cout << "Couldn't open the manifest " << fileName << ".\n";
+        return 1;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline(in, line))
+    {
+        lineNumber++;
+
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        line = trim(line);
+        if (line.empty())
+            continue;
+
+        size_t equals = line.find('=');
+        if (equals == std::string::npos)
+        {
+            std::cout << fileName << ":" << lineNumber << ": expected key = value.\n";
+            return 1;
+        }
+
+        std::string key = trim(line.substr(0, equals));
+        std::string value = trim(line.substr(equals + 1));
+
+        if (key == "program")
+            program = value;
+        else if (key == "config")
+            config = value;
+        else if (key == "output")
+            output = value;
+        else if (key == "layout")
+            layout = value;
+        else if (key == "args")
+            args = value;
+        else if (key == "replicas")
+            replicas = atoi(value.c_str());
+        else if (key == "seed-stride")
+            seedStride = atoi(value.c_str());
+        else if (key == "workers")
+            workers = atoi(value.c_str());
+        else if (key == "measure")
+            measure = value;
+        else if (key == "observables")
+            observables = split(value);
+        else if (key == "precision")
+            precision = atof(value.c_str());
+        else if (key == "tolerance")
+            tolerance = atof(value.c_str());
+        else if (key == "max-replicas")
+            maxReplicas = atoi(value.c_str());
+        else if (key == "seeds")
+        {
+            std::vector<std::string> words = split(value);
+            for (size_t w = 0; w < words.size(); w++)
+                seeds.push_back(atoi(words[w].c_str()));
+        }
+        else if (key.compare(0, 5, "axis ") == 0)
+        {
+            Axis axis;
+            axis.name = trim(key.substr(5));
+
+            if (parseValues(value, axis.values))
+            {
+                std::cout << fileName << ":" << lineNumber << ": bad values for axis "
+                    << axis.name << ".\n";
+                return 1;
+            }
+
+            axes.push_back(axis);
+        }
+        else
+        {
+            std::cout << fileName << ":" << lineNumber << ": unknown key " << key << ".\n";
+            return 1;
+        }
+    }
+
+    if (output.empty())
+    {
+        std::cout << "The manifest must give an output directory.\n";
+        return 1;
+    }
+
+    if (replicas < 1 || workers < 1)
+    {
+        std::cout << "replicas and workers must be positive.\n";
+        return 1;
+    }
+
+    if (maxReplicas == 0)
+        maxReplicas = replicas;
+
+    if (maxReplicas < replicas)
+    {
+        std::cout << "max-replicas must be at least replicas.\n";
+        return 1;
+    }
+
+    if (maxReplicas > replicas && measure.empty())
+    {
+        std::cout << "Adaptive ensembles (max-replicas) need a measure command.\n";
+        return 1;
+    }
+
+    if (precision < 0.0 || tolerance < 0.0 || (precision == 0.0 && tolerance == 0.0))
+    {
+        std::cout << "precision and tolerance must not be negative, nor both zero.\n";
+        return 1;
+    }
+
+    if (seeds.empty())
+        seeds.push_back(1);
+
+    // The default layout has one directory level per axis and the seed.
+
+    if (layout.empty())
+    {
+        for (size_t a = 0; a < axes.size(); a++)
+            layout += axes[a].name + "_{" + axes[a].name + "}/";
+        layout += "seed_{seed}";
+    }
+
+    return 0;
+}
+
+static void replace(std::string &str, std::string from, std::string to)
+{
+    for (size_t at = str.find(from); at != std::string::npos;
+            at = str.find(from, at + to.size()))
+        str.replace(at, from.size(), to);
+}
+
+// addReplicas adds the tasks of replicas first to last - 1 of every seed of
+// a parameter point.
+
+static void addReplicas(const Manifest &manifest, std::vector<Task> &tasks,
+        size_t point, const std::vector<size_t> &index, int first, int last)
+{
+    std::vector<std::string> extra = split(manifest.args);
+
+    for (size_t s = 0; s < manifest.seeds.size(); s++)
+    {
+        for (int r = first; r < last; r++)
+        {
+            Task task;
+            task.dir = manifest.layout;
+            task.point = point;
+
+            int seed = manifest.seeds[s] + r * manifest.seedStride;
+            char seedText[16];
+            snprintf(seedText, sizeof(seedText), "%d", seed);
+
+            if (!manifest.config.empty())
+            {
+                task.args.push_back("-c");
+                task.args.push_back(manifest.config);
+            }
+
+            for (size_t a = 0; a < manifest.axes.size(); a++)
+            {
+                const Axis &axis = manifest.axes[a];
+                replace(task.dir, "{" + axis.name + "}", axis.values[index[a]]);
+                task.args.push_back("--" + axis.name);
+                task.args.push_back(axis.values[index[a]]);
+            }
+
+            replace(task.dir, "{seed}", seedText);
+
+            task.args.push_back("--prng");
+            task.args.push_back(seedText);
+            task.args.insert(task.args.end(), extra.begin(), extra.end());
+
+            tasks.push_back(task);
+        }
+    }
+}
+
+// expand returns the parameter points of the sweep, the product of all
+// axes with the last axis varying fastest, and adds the tasks of their first
+// replicas.
+
+static std::vector<Point> expand(const Manifest &manifest, std::vector<Task> &tasks)
+{
+    std::vector<Point> points;
+    std::vector<size_t> index(manifest.axes.size(), 0);
+
+    while (true)
+    {
+        Point point;
+        point.index = index;
+        point.replicas = manifest.replicas;
+        points.push_back(point);
+
+        addReplicas(manifest, tasks, points.size() - 1, index, 0, manifest.replicas);
+
+        // Advance the axes like the digits of a number.
+
+        int a = (int) manifest.axes.size() - 1;
+
+        while (a >= 0 && ++index[a] == manifest.axes[a].values.size())
+            index[a--] = 0;
+
+        if (a < 0)
+            break;
+    }
+
+    return points;
+}
+
+// readLedger returns the tasks that have finished successfully, with their
+// measured values.
+
+static Ledger readLedger(std::string fileName)
+{
+    Ledger done;
+    std::ifstream in(fileName.c_str());
+    std::string line;
+
+    while (std::getline(in, line))
+    {
+        std::istringstream fields(line);
+        std::string status, dir, value;
+        double seconds;
+
+        if (!(fields >> status >> seconds >> dir) || status != "done")
+            continue;
+
+        std::map<std::string, double> &values = done[dir];
+        values.clear();
+
+        while (fields >> value)
+        {
+            size_t equals = value.rfind('=');
+            if (equals != std::string::npos)
+                values[value.substr(0, equals)] = atof(value.c_str() + equals + 1);
+        }
+    }
+
+    return done;
+}
+
+// measure runs the measure command of the manifest for the task in dir and
+// reads the values it prints. It returns 0, or 1 if the command fails or
+// prints no table.
+
+static int measure(const Manifest &manifest, std::string dir,
+        std::map<std::string, double> &values)
+{
+    std::string command = manifest.measure;
+    replace(command, "{dir}", dir);
+
+    FILE *out = popen(command.c_str(), "r");
+
+    if (out == NULL)
+        return 1;
+
+    std::vector<std::string> lines;
+    char buffer[4096];
+
+    while (fgets(buffer, sizeof(buffer), out) != NULL)
+    {
+        std::string line = trim(std::string(buffer).substr(0, strcspn(buffer, "\n")));
+        if (!line.empty())
+            lines.push_back(line);
+    }
+
+    if (pclose(out) != 0 || lines.size() < 2)
+        return 1;
+
+    // Pair the header with the last line, keeping the numeric columns.
+
+    std::istringstream names(lines[0]), fields(lines.back());
+    std::string name, field;
+
+    while (std::getline(names, name, ',') && std::getline(fields, field, ','))
+    {
+        char *end;
+        double value = strtod(field.c_str(), &end);
+        name = trim(name);
+        std::replace(name.begin(), name.end(), ' ', '_');
+
+        if (end != field.c_str() && trim(end).empty() && !name.empty())
+            values[name] = value;
+    }
+
+    return values.empty() ? 1 : 0;
+}
+
+// makeDirs creates the directory path and all its parents.
+
+static int makeDirs(std::string path)
+{
+    for (size_t at = path.find('/', 1); at != std::string::npos;
+            at = path.find('/', at + 1))
+        if (mkdir(path.substr(0, at).c_str(), 0755) != 0 && errno != EEXIST)
+            return 1;
+
+    if (mkdir(path.c_str(), 0755) != 0 && errno != EEXIST)
+        return 1;
+
+    return 0;
+}
+
+static double now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+// launch starts the integrator for a task in a new process, with its output
+// going to log.txt in the directory of the task, and returns its process id
+// (or -1).
+
+static pid_t launch(const Manifest &manifest, const Task &task, std::string dir)
+{
+    std::vector<std::string> args;
+    args.push_back(manifest.program);
+    args.insert(args.end(), task.args.begin(), task.args.end());
+    args.push_back("--output");
+    args.push_back(dir);
+
+    pid_t pid = fork();
+
+    if (pid != 0)
+        return pid;
+
+    std::string logName = dir + "/log.txt";
+    int log = open(logName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (log >= 0)
+    {
+        dup2(log, 1);
+        dup2(log, 2);
+        close(log);
+    }
+
+    std::vector<char *> argv;
+    for (size_t a = 0; a < args.size(); a++)
+        argv.push_back(const_cast<char *>(args[a].c_str()));
+    argv.push_back(NULL);
+
+    execv(argv[0], &argv[0]);
+    perror(argv[0]);
+    _exit(127);
+}
+
+// Sweep is the state of a running sweep: its tasks, the parameter points
+// they belong to and the queue of tasks to run.
+struct Sweep {
+
+    const Manifest &manifest;
+    std::vector<Task> tasks;
+    std::vector<Point> points;
+    Ledger done;
+    std::vector<size_t> todo;
+
+    Sweep(const Manifest &mmanifest) : manifest(mmanifest) {}
+
+    // schedule queues the tasks from first on, except those that the ledger
+    // has as done, whose values are added to their points right away.
+    void schedule(size_t first);
+
+    // record adds the values measured for a task to its point.
+    void record(size_t t, const std::map<std::string, double> &values);
+
+    // refine adds replicas to point p, once it has no tasks left to run,
+    // until its observables are as precise as wanted or it has max-replicas.
+    // A point with failed tasks is left as it is, since its failures are
+    // retried first when the sweep is run again.
+    void refine(size_t p);
+
+    // describe returns the axis values of point p.
+    std::string describe(size_t p) const;
+
+    // summarize writes the statistics of every point to the file.
+    void summarize(FILE *file) const;
+
+};
+
+void Sweep::schedule(size_t first)
+{
+    for (size_t t = first; t < tasks.size(); t++)
+    {
+        Ledger::const_iterator entry = done.find(tasks[t].dir);
+
+        if (entry == done.end())
+        {
+            todo.push_back(t);
+            points[tasks[t].point].pending++;
+            continue;
+        }
+
+        // Tasks recorded before there was a measure command are measured
+        // now.
+
+        std::map<std::string, double> values = entry->second;
+
+        if (values.empty() && !manifest.measure.empty())
+            measure(manifest, manifest.output + "/" + tasks[t].dir, values);
+
+        record(t, values);
+    }
+}
+
+void Sweep::record(size_t t, const std::map<std::string, double> &values)
+{
+    Point &point = points[tasks[t].point];
+
+    for (std::map<std::string, double>::const_iterator v = values.begin();
+            v != values.end(); v++)
+        point.stats[v->first].add(v->second);
+}
+
+// replicasNeeded returns the replicas per seed that the point needs for the
+// wanted precision, estimated from the variance of its samples so far.
+
+static int replicasNeeded(const Manifest &manifest, const Point &point)
+{
+    std::vector<std::string> names = manifest.observables;
+
+    if (names.empty())
+        for (std::map<std::string, Stats>::const_iterator s = point.stats.begin();
+                s != point.stats.end(); s++)
+            names.push_back(s->first);
+
+    if (names.empty())
+        return point.replicas + 1;
+
+    double factor = 1.0;
+    int samples = 0;
+
+    for (size_t o = 0; o < names.size(); o++)
+    {
+        std::map<std::string, Stats>::const_iterator s = point.stats.find(names[o]);
+
+        if (s == point.stats.end() || s->second.n < 2)
+            return point.replicas + 1;
+
+        // A target of zero (a mean of zero and no tolerance) is only met
+        // without any spread; otherwise the ratio is infinite, and the point
+        // grows as fast as it may.
+
+        double target = std::max(manifest.precision * fabs(s->second.mean),
+                manifest.tolerance);
+        double halfWidth = s->second.halfWidth();
+        double ratio = halfWidth <= target ? 0.0 : halfWidth / target;
+
+        factor = std::max(factor, ratio * ratio);
+        samples = std::max(samples, s->second.n);
+    }
+
+    if (factor <= 1.0)
+        return point.replicas;
+
+    // Cap the count before converting it, as factor may be infinite.
+
+    int seeds = manifest.seeds.size();
+    double needed = std::min(ceil(samples * factor / seeds), 2.0 * point.replicas);
+
+    return std::max(point.replicas + 1, (int) needed);
+}
+
+void Sweep::refine(size_t p)
+{
+    while (points[p].pending == 0 && points[p].failed == 0
+            && points[p].replicas < manifest.maxReplicas)
+    {
+        int needed = std::min(replicasNeeded(manifest, points[p]), manifest.maxReplicas);
+
+        if (needed <= points[p].replicas)
+            break;
+
+        printf("%s: not yet precise; %d replicas per seed.\n", describe(p).c_str(),
+                needed);
+        fflush(stdout);
+
+        size_t first = tasks.size();
+        addReplicas(manifest, tasks, p, points[p].index, points[p].replicas, needed);
+        points[p].replicas = needed;
+        schedule(first);
+    }
+}
+
+std::string Sweep::describe(size_t p) const
+{
+    std::string text;
+
+    for (size_t a = 0; a < manifest.axes.size(); a++)
+        text += (a > 0 ? " " : "") + manifest.axes[a].name + "="
+            + manifest.axes[a].values[points[p].index[a]];
+
+    return text.empty() ? "sweep" : text;
+}
+
+void Sweep::summarize(FILE *file) const
+{
+    std::set<std::string> names;
+
+    for (size_t p = 0; p < points.size(); p++)
+        for (std::map<std::string, Stats>::const_iterator s = points[p].stats.begin();
+                s != points[p].stats.end(); s++)
+            names.insert(s->first);
+
+    for (size_t a = 0; a < manifest.axes.size(); a++)
+        fprintf(file, "%s,", manifest.axes[a].name.c_str());
+    fprintf(file, "replicas");
+    for (std::set<std::string>::const_iterator n = names.begin(); n != names.end(); n++)
+        fprintf(file, ",%s_n,%s,%s_error,%s_ci", n->c_str(), n->c_str(), n->c_str(),
+                n->c_str());
+    fprintf(file, "\n");
+
+    for (size_t p = 0; p < points.size(); p++)
+    {
+        for (size_t a = 0; a < manifest.axes.size(); a++)
+            fprintf(file, "%s,", manifest.axes[a].values[points[p].index[a]].c_str());
+        fprintf(file, "%d", points[p].replicas);
+
+        for (std::set<std::string>::const_iterator n = names.begin(); n != names.end(); n++)
+        {
+            std::map<std::string, Stats>::const_iterator s = points[p].stats.find(*n);
+            Stats stats = s == points[p].stats.end() ? Stats() : s->second;
+
+            fprintf(file, ",%d,%.6g,%.3g,%.3g", stats.n, stats.mean, stats.error(),
+                    stats.halfWidth());
+        }
+
+        fprintf(file, "\n");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::string manifestName;
+    int workers;
+
+    po::options_description options("Sweep options");
+    options.add_options()
+        ("help,h", "show this help text")
+        ("manifest", po::value<std::string>(&manifestName), "sweep manifest")
+        ("workers,w", po::value<int>(&workers)->default_value(0),
+             "number of simultaneous tasks (0: as in the manifest)")
+        ("dry-run", "list the tasks that would be run, and run nothing")
+        ;
+
+    po::positional_options_description positional;
+    positional.add("manifest", 1);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(options)
+            .positional(positional).run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help") || manifestName.empty())
+    {
+        std::cout << "Usage: sweep.out manifest [options]\n" << options << std::endl;
+        return 1;
+    }
+
+    Manifest manifest;
+
+    if (manifest.read(manifestName))
+        return 1;
+
+    if (workers > 0)
+        manifest.workers = workers;
+
+    // By default, run the integrator that was built next to this program.
+
+    if (manifest.program.empty())
+    {
+        std::string self = argv[0];
+        size_t slash = self.rfind('/');
+        manifest.program = (slash == std::string::npos ? std::string(".")
+                : self.substr(0, slash)) + "/integrator.out";
+    }
+
+    Sweep sweep(manifest);
+    std::vector<Task> &tasks = sweep.tasks;
+    std::vector<size_t> &todo = sweep.todo;
+    std::string ledgerName = manifest.output + "/ledger.txt";
+
+    sweep.points = expand(manifest, tasks);
+    sweep.done = readLedger(ledgerName);
+    sweep.schedule(0);
+
+    for (size_t p = 0; p < sweep.points.size(); p++)
+        sweep.refine(p);
+
+    printf("%zu tasks, %zu done, %zu to run on %d workers.\n", tasks.size(),
+            tasks.size() - todo.size(), todo.size(), manifest.workers);
+
+    if (manifest.maxReplicas > manifest.replicas)
+        printf("Points get up to %d replicas per seed until the confidence "
+                "intervals are within %g (or %g).\n", manifest.maxReplicas,
+                manifest.precision, manifest.tolerance);
+
+    if (vm.count("dry-run"))
+    {
+        for (size_t t = 0; t < todo.size(); t++)
+        {
+            printf("%s:", tasks[todo[t]].dir.c_str());
+            for (size_t a = 0; a < tasks[todo[t]].args.size(); a++)
+                printf(" %s", tasks[todo[t]].args[a].c_str());
+            printf("\n");
+        }
+        return 0;
+    }
+
+    if (makeDirs(manifest.output))
+    {
+        std::cout << "Couldn't create " << manifest.output << ".\n";
+        return 1;
+    }
+
+    FILE *ledger = fopen(ledgerName.c_str(), "a");
+
+    if (ledger == NULL)
+    {
+        std::cout << "Couldn't open the ledger " << ledgerName << ".\n";
+        return 1;
+    }
+
+    // The worker pool: keep up to workers tasks running, and record every
+    // task in the ledger as soon as it finishes. Finishing the last task of
+    // a point may add more tasks for it.
+
+    std::map<pid_t, size_t> running;
+    std::map<pid_t, double> started;
+    size_t next = 0;
+    int failed = 0;
+
+    while (next < todo.size() || !running.empty())
+    {
+        while (next < todo.size() && (int) running.size() < manifest.workers)
+        {
+            const Task &task = tasks[todo[next]];
+            std::string dir = manifest.output + "/" + task.dir;
+
+            if (makeDirs(dir))
+            {
+                std::cout << "Couldn't create " << dir << ".\n";
+                failed++;
+                sweep.points[task.point].pending--;
+                sweep.points[task.point].failed++;
+                sweep.refine(task.point);
+                next++;
+                continue;
+            }
+
+            pid_t pid = launch(manifest, task, dir);
+
+            // If fork fails, try again once a running task has finished. With
+            // none running there is nothing to wait for, so the tasks left
+            // fail (they aren't in the ledger, so running the sweep again
+            // retries them).
+
+            if (pid < 0)
+            {
+                perror("fork");
+
+                if (running.empty())
+                {
+                    for (; next < todo.size(); next++)
+                    {
+                        failed++;
+                        sweep.points[tasks[todo[next]].point].pending--;
+                        sweep.points[tasks[todo[next]].point].failed++;
+                    }
+                }
+
+                break;
+            }
+
+            running[pid] = todo[next];
+            started[pid] = now();
+            next++;
+        }
+
+        if (running.empty())
+            break;
+
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+
+        if (pid < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("waitpid");
+            break;
+        }
+
+        if (!running.count(pid))
+            continue;
+
+        size_t t = running[pid];
+        std::string dir = tasks[t].dir;
+        double seconds = now() - started[pid];
+        int code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        std::map<std::string, double> values;
+        bool measured = code != 0 || manifest.measure.empty()
+            || measure(manifest, manifest.output + "/" + dir, values) == 0;
+
+        if (code != 0)
+            fprintf(ledger, "failed:%d %.3f %s\n", code, seconds, dir.c_str());
+        else if (!measured)
+            fprintf(ledger, "failed:measure %.3f %s\n", seconds, dir.c_str());
+        else
+        {
+            fprintf(ledger, "done %.3f %s", seconds, dir.c_str());
+            for (std::map<std::string, double>::iterator v = values.begin();
+                    v != values.end(); v++)
+                fprintf(ledger, " %s=%.10g", v->first.c_str(), v->second);
+            fprintf(ledger, "\n");
+        }
+
+        fflush(ledger);
+        fsync(fileno(ledger));
+
+        printf("%s %s (%.1f s)\n", code == 0 && measured ? "done" : "FAILED",
+                dir.c_str(), seconds);
+        fflush(stdout);
+
+        if (code != 0 || !measured)
+        {
+            failed++;
+            sweep.points[tasks[t].point].failed++;
+        }
+
+        running.erase(pid);
+        started.erase(pid);
+
+        sweep.points[tasks[t].point].pending--;
+        sweep.record(t, values);
+        sweep.refine(tasks[t].point);
+    }
+
+    fclose(ledger);
+
+    if (!manifest.measure.empty())
+    {
+        std::string summaryName = manifest.output + "/ensemble.txt";
+        FILE *summary = fopen(summaryName.c_str(), "w");
+
+        if (summary == NULL)
+            std::cout << "Couldn't write " << summaryName << ".\n";
+        else
+        {
+            sweep.summarize(summary);
+            fclose(summary);
+        }
+
+        sweep.summarize(stdout);
+    }
+
+    if (failed)
+    {
+        printf("%d tasks failed; run the sweep again to retry them.\n", failed);
+        return 2;
+    }
+
+    return 0;
+}
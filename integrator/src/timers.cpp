@@ -0,0 +1,164 @@
+// timers.cpp
+// ----------
+//
+// timers.cpp holds the counters declared in timers.h and prints them. It is
+// empty unless the integrator is built with -DTIMERS.
+
+#include "timers.h"
+
+#ifdef TIMERS
+
+#include <cstdio>
+
+PhaseTimers phaseTimers;
+
+static const char *phaseNames[num_phases] = {
+    "force", "stress", "motor", "move", "step", "output"
+};
+
+#ifdef PERFCOUNTERS
+
+// phaseCounts stores the counts of phase in c, without the motors for the
+// force phase, like the times.
+
+static void phaseCounts(int p, double c[PerfCounters::num_counters])
+{
+    for (int k = 0; k < PerfCounters::num_counters; k++)
+        c[k] = p == force_phase
+            ? phaseTimers.counts[p][k] - phaseTimers.counts[motor_phase][k]
+            : phaseTimers.counts[p][k];
+}
+
+// printCount prints x with the format, or "-" if it is missing.
+
+static void printCount(const char *format, int width, double x)
+{
+    if (x == x)
+        printf(format, x);
+    else
+        printf("%*s", width, "-");
+}
+
+#endif
+
+PhaseTimers::PhaseTimers() :
+    nodeSteps(0.0),
+    bytesWritten(0.0)
+{
+    for (int p = 0; p < num_phases; p++)
+        total[p] = 0.0;
+
+#ifdef PERFCOUNTERS
+    for (int p = 0; p < num_phases; p++)
+    {
+        calls[p] = 0.0;
+        for (int c = 0; c < PerfCounters::num_counters; c++)
+            counts[p][c] = 0.0;
+    }
+
+    nodesPerCall = 0.0;
+#endif
+
+    started = now();
+}
+
+void PhaseTimers::printLine(int step)
+{
+    double elapsed = now() - started;
+
+    // The progress marks have no newline, so start a fresh line.
+    printf("\n#timers step=%d elapsed=%.6f", step, elapsed);
+
+    for (int p = 0; p < num_phases; p++)
+    {
+        double t = p == force_phase ? total[p] - total[motor_phase] : total[p];
+        printf(" %s=%.6f", phaseNames[p], t);
+    }
+
+    printf(" node_steps_per_s=%.6g bytes=%.0f",
+            elapsed > 0 ? nodeSteps / elapsed : 0.0, bytesWritten);
+
+#ifdef PERFCOUNTERS
+    for (int p = 0; p < num_phases; p++)
+    {
+        double c[PerfCounters::num_counters];
+
+        if (calls[p] == 0)
+            continue;
+
+        phaseCounts(p, c);
+        double ipc = c[PerfCounters::instructions] / c[PerfCounters::cycles];
+
+        if (ipc == ipc)
+            printf(" %s_ipc=%.4g", phaseNames[p], ipc);
+        else
+            printf(" %s_ipc=nan", phaseNames[p]);
+    }
+#endif
+
+    printf("\n");
+    fflush(stdout);
+}
+
+void PhaseTimers::printSummary()
+{
+    double elapsed = now() - started;
+    double phases = 0.0;
+
+    printf("\nPhase        Seconds   Fraction\n");
+
+    for (int p = 0; p < num_phases; p++)
+    {
+        double t = p == force_phase ? total[p] - total[motor_phase] : total[p];
+        phases += t;
+        printf("%-10s %9.3f %9.1f%%\n", phaseNames[p], t,
+                elapsed > 0 ? 100.0 * t / elapsed : 0.0);
+    }
+
+    printf("%-10s %9.3f %9.1f%%\n", "other", elapsed - phases,
+            elapsed > 0 ? 100.0 * (elapsed - phases) / elapsed : 0.0);
+    printf("%-10s %9.3f\n\n", "total", elapsed);
+
+    printf("Node-steps per second: %.4g\n", elapsed > 0 ? nodeSteps / elapsed : 0.0);
+    printf("Bytes written:         %.0f (%.4g MB/s during output)\n",
+            bytesWritten, total[output_phase] > 0
+            ? bytesWritten / total[output_phase] * 1e-6 : 0.0);
+
+#ifdef PERFCOUNTERS
+    // The counts per node-step of the phases that visit every node of this
+    // process once per call. The fused step does everything in one call.
+
+    if (!counters.available())
+    {
+        printf("\nNo hardware counters are available on this machine.\n");
+        return;
+    }
+
+    printf("\nPhase         cycles     instr      IPC     L1miss    LLCmiss     brmiss  bound\n");
+
+    for (int p = 0; p < num_phases; p++)
+    {
+        if (p == output_phase || calls[p] == 0 || nodesPerCall <= 0)
+            continue;
+
+        double c[PerfCounters::num_counters];
+        double n = calls[p] * nodesPerCall;
+
+        phaseCounts(p, c);
+
+        printf("%-10s", phaseNames[p]);
+        printCount(" %9.2f", 10, c[PerfCounters::cycles] / n);
+        printCount(" %9.2f", 10, c[PerfCounters::instructions] / n);
+        printCount(" %8.2f", 9, c[PerfCounters::instructions] / c[PerfCounters::cycles]);
+        printCount(" %10.4f", 11, c[PerfCounters::l1_misses] / n);
+        printCount(" %10.4f", 11, c[PerfCounters::llc_misses] / n);
+        printCount(" %10.4f", 11, c[PerfCounters::branch_misses] / n);
+        printf("  %s\n", PerfCounters::bound(c[PerfCounters::cycles],
+                    c[PerfCounters::instructions], c[PerfCounters::llc_misses]));
+    }
+
+    printf("(counts per node-step of the first process)\n");
+#endif
+}
+
+#endif /* TIMERS */
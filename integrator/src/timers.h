@@ -0,0 +1,119 @@
+#ifndef TIMERS_H_
+#define TIMERS_H_
+
+// timers.h
+// --------
+//
+// timers.h provides low-overhead instrumentation for production runs. When
+// the integrator is built with -DTIMERS (make TIMERS=1), the wall time spent
+// in each phase of a time step is accumulated, together with the number of
+// node-steps simulated and the number of bytes written to output files. A
+// summary is printed when the run ends, and a machine-readable line can be
+// printed every few frames (--timer-frames).
+//
+// Without -DTIMERS the macros below expand to nothing, so the timers cost
+// nothing at all.
+//
+// Builds with -DPERFCOUNTERS (make PERFCOUNTERS=1, which implies TIMERS) also
+// read the hardware counters of perfcounters.h at the start and end of each
+// phase, and the summary gives the IPC, the misses per node-step and a hint
+// whether the phase is compute-, latency- or bandwidth-bound. The counters
+// cost a system call at each start and end, and like the timers they are
+// printed for the first process only.
+//
+// The motor phase is timed inside getNetForces, so it is nested in the force
+// phase; the summary reports the force phase without the motors. The step
+// phase is the fused step of Network::step (see --autotune), which does the
+// work of all the other phases but output, motors included.
+
+enum Phase {
+    force_phase, stress_phase, motor_phase, move_phase, step_phase,
+    output_phase, num_phases
+};
+
+#ifdef TIMERS
+
+#include <ctime>
+
+#ifdef PERFCOUNTERS
+#include "perfcounters.h"
+#endif
+
+struct PhaseTimers {
+
+    double total[num_phases];   // Seconds spent in each phase
+    double started;             // Time at which the run started
+    double nodeSteps;           // Number of node-steps simulated
+    double bytesWritten;        // Number of bytes written to output files
+
+#ifdef PERFCOUNTERS
+    PerfCounters counters;
+    double counts[num_phases][PerfCounters::num_counters];
+    double begin[num_phases][PerfCounters::num_counters];
+    double calls[num_phases];   // Times each phase ran
+    double nodesPerCall;        // Node-steps of this process per call
+
+    void startCounters(int phase) { counters.read(begin[phase]); }
+    void stopCounters(int phase) {
+
+        double end[PerfCounters::num_counters];
+        counters.read(end);
+
+        for (int c = 0; c < PerfCounters::num_counters; c++)
+            counts[phase][c] += end[c] - begin[phase][c];
+        calls[phase]++;
+    }
+#endif
+
+    PhaseTimers();
+
+    static inline double now() {
+
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + 1e-9 * ts.tv_nsec;
+    }
+
+    // printLine prints the counters accumulated so far as one line of
+    // key=value pairs, starting with "#timers".
+    void printLine(int step);
+
+    // printSummary prints a human-readable table of the counters.
+    void printSummary();
+
+};
+
+extern PhaseTimers phaseTimers;
+
+#ifdef PERFCOUNTERS
+#define TIMER_START(phase) \
+    double timer_start_##phase = (phaseTimers.startCounters(phase), PhaseTimers::now())
+#define TIMER_STOP(phase) do { \
+    phaseTimers.total[phase] += PhaseTimers::now() - timer_start_##phase; \
+    phaseTimers.stopCounters(phase); \
+} while (0)
+#define TIMER_NODES(n) phaseTimers.nodesPerCall = (n)
+#else
+#define TIMER_START(phase) double timer_start_##phase = PhaseTimers::now()
+#define TIMER_STOP(phase) \
+    phaseTimers.total[phase] += PhaseTimers::now() - timer_start_##phase
+#define TIMER_NODES(n) do {} while (0)
+#endif
+#define TIMER_NODE_STEPS(n) phaseTimers.nodeSteps += (n)
+#define TIMER_BYTES(n) phaseTimers.bytesWritten += (n)
+#define TIMER_LINE(step) phaseTimers.printLine(step)
+#define TIMER_SUMMARY() phaseTimers.printSummary()
+
+#else
+
+#define TIMER_START(phase) do {} while (0)
+#define TIMER_STOP(phase) do {} while (0)
+#define TIMER_NODE_STEPS(n) do {} while (0)
+#define TIMER_NODES(n) do {} while (0)
+#define TIMER_BYTES(n) do {} while (0)
+#define TIMER_LINE(step) do {} while (0)
+#define TIMER_SUMMARY() do {} while (0)
+
+#endif /* TIMERS */
+
+#endif /* TIMERS_H_ */
@@ -0,0 +1,227 @@
+/* top.cpp
+ * -------
+ *
+ * top.cpp is integrator-top, which shows the progress of all the integrator
+ * runs of this machine from the status records they publish (see status.h).
+ * It only maps the status files for reading, so it never slows the runs
+ * down. Every run gets a line:
+ *
+ *   PID    process of the run
+ *   N      size of the lattice (unused by a graph run)
+ *   STEP   step reached and its share of all steps
+ *   TIME   simulated time
+ *   STRAIN strain of the network
+ *   STRESS stress of the last frame
+ *   NONAFF latest nonaffinity sample
+ *   RATE   steps per second over the last frame
+ *   ETA    time left at that rate
+ *   STATE  run; xN while the health monitor splits steps into N substeps;
+ *          stalled if the run has not reached its next frame in three times
+ *          the time a frame took plus ten seconds (so that a run with fast
+ *          frames isn't stalled by a short pause of the machine); dead if the
+ *          process is gone (the run crashed without removing its status file)
+ *   OUTPUT output path of the run
+ *
+ * Usage: integrator-top.out [--dir d] [--interval s] [--once] [--clean]
+ */
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <iostream>
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <boost/program_options.hpp>
+
+#include "status.h"
+
+namespace po = boost::program_options;
+
+struct Run {
+    std::string path;
+    StatusData data;
+    bool alive;
+};
+
+static double wallClock()
+{
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+// readRun reads the status file at path. It returns false if the file is
+// not a status record (e.g. a truncated one); a file shorter than the page
+// is skipped, since reading past its end would fault.
+
+static bool readRun(std::string path, Run &run)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+
+    if (fd < 0)
+        return false;
+
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(StatusPage))
+    {
+        close(fd);
+        return false;
+    }
+
+    void *mem = mmap(NULL, sizeof(StatusPage), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mem == MAP_FAILED)
+        return false;
+
+    bool ok = readStatus(static_cast<const StatusPage *>(mem), run.data);
+    munmap(mem, sizeof(StatusPage));
+
+    run.path = path;
+    run.alive = ok && (kill(run.data.pid, 0) == 0 || errno == EPERM);
+
+    return ok;
+}
+
+static std::vector<Run> findRuns(std::string dir)
+{
+    std::vector<Run> runs;
+    DIR *d = opendir(dir.c_str());
+
+    if (d == NULL)
+        return runs;
+
+    while (dirent *entry = readdir(d))
+    {
+        std::string name = entry->d_name;
+        Run run;
+
+        if (name.compare(0, 11, "integrator-") != 0 || name.size() < 7
+                || name.compare(name.size() - 7, 7, ".status") != 0)
+            continue;
+
+        if (readRun(dir + "/" + name, run))
+            runs.push_back(run);
+    }
+
+    closedir(d);
+
+    std::sort(runs.begin(), runs.end(),
+            [](const Run &a, const Run &b) { return a.data.pid < b.data.pid; });
+
+    return runs;
+}
+
+// duration formats seconds as h:mm:ss.
+
+static std::string duration(double seconds)
+{
+    if (seconds < 0)
+        return "-";
+
+    char text[32];
+    long s = (long) (seconds + 0.5);
+
+    snprintf(text, sizeof(text), "%ld:%02ld:%02ld", s / 3600, s / 60 % 60, s % 60);
+    return text;
+}
+
+static void show(const std::vector<Run> &runs)
+{
+    double now = wallClock();
+
+    printf("%-8s %5s %16s %10s %9s %11s %11s %9s %9s %-8s %s\n", "PID", "N",
+            "STEP", "TIME", "STRAIN", "STRESS", "NONAFF", "RATE", "ETA", "STATE",
+            "OUTPUT");
+
+    for (size_t r = 0; r < runs.size(); r++)
+    {
+        const StatusData &d = runs[r].data;
+        char step[32], state[16];
+
+        snprintf(step, sizeof(step), "%d %3.0f%%", d.step,
+                d.nTimeSteps > 0 ? 100.0 * d.step / d.nTimeSteps : 0.0);
+
+        double frame = d.stepsPerSecond > 0 ? d.frameSteps / d.stepsPerSecond : 0.0;
+
+        if (!runs[r].alive)
+            strcpy(state, "dead");
+        else if (d.step > 0 && now - d.updated > 3 * frame + 10)
+            strcpy(state, "stalled");
+        else if (d.substeps > 1)
+            snprintf(state, sizeof(state), "x%d", d.substeps);
+        else
+            strcpy(state, "run");
+
+        printf("%-8d %5d %16s %10.4g %9.3g %11.4g %11.4g %9.4g %9s %-8s %s\n",
+                d.pid, d.netSize, step, d.time, d.strain, d.stress, d.nonaff,
+                d.stepsPerSecond, duration(d.eta).c_str(), state, d.label);
+    }
+
+    if (runs.empty())
+        printf("(no runs)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    std::string dir;
+    double interval;
+
+    po::options_description options("integrator-top options");
+    options.add_options()
+        ("help,h", "show this help text")
+        ("dir,d", po::value<std::string>(&dir)->default_value("/dev/shm"),
+             "directory of the status files (--status-dir of the integrator)")
+        ("interval,i", po::value<double>(&interval)->default_value(2.0),
+             "seconds between updates")
+        ("once", "show the runs once and exit")
+        ("clean", "remove the status files of dead runs")
+        ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, options), vm);
+    po::notify(vm);
+
+    if (vm.count("help"))
+    {
+        std::cout << "Usage: integrator-top.out [options]\n" << options << std::endl;
+        return 1;
+    }
+
+    if (vm.count("clean"))
+    {
+        std::vector<Run> runs = findRuns(dir);
+
+        for (size_t r = 0; r < runs.size(); r++)
+        {
+            if (!runs[r].alive && unlink(runs[r].path.c_str()) == 0)
+                printf("Removed %s.\n", runs[r].path.c_str());
+        }
+
+        return 0;
+    }
+
+    if (vm.count("once") || interval <= 0)
+    {
+        show(findRuns(dir));
+        return 0;
+    }
+
+    while (true)
+    {
+        // Clear the terminal and redraw.
+        printf("\033[H\033[2J");
+        show(findRuns(dir));
+        fflush(stdout);
+
+        usleep((useconds_t) (interval * 1e6));
+    }
+}
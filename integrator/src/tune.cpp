@@ -0,0 +1,308 @@
+// tune.cpp
+// --------
+//
+// tune.cpp implements the autotuner declared in tune.h.
+
+#include <cstdio>
+#include <cmath>
+#include <ctime>
+#include <vector>
+#include <thread>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "tune.h"
+#include "network.h"
+#include "motors.h"
+#include "domain.h"
+
+static double now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+static std::string hostName()
+{
+    char name[256];
+
+    if (gethostname(name, sizeof(name)) != 0)
+        return "unknown";
+
+    name[sizeof(name) - 1] = '\0';
+    return name;
+}
+
+static void describe(const Tuning &t)
+{
+    printf("%d process%s, ", t.procs, t.procs == 1 ? "" : "es");
+
+    if (t.tile > 0)
+        printf("fused step with tiles of %d row%s", t.tile, t.tile == 1 ? "" : "s");
+    else
+        printf("separate kernels");
+}
+
+// runCandidate integrates the network with the configuration t for about the
+// given number of seconds, and returns the node-steps per second in the first
+// process. It runs in a child process of the integrator.
+
+static double runCandidate(const Tuning &t, double ***spring,
+        const Protocol &protocol, int nTimeSteps, double temp, bool motors,
+        double seconds)
+{
+    Domain domain(t.procs);
+    double *pos = domain.allocate(2 * netSize * netSize);
+    double *delta = domain.allocate(2 * netSize * netSize);
+    double *stop = domain.allocate(1);
+
+    for (int i = 0; i < netSize; i++)
+    {
+        for (int j = 0; j < netSize; j++)
+        {
+            pos[(i * netSize + j) * 2] = RESTLEN * (i / 2.0 + j);
+            pos[(i * netSize + j) * 2 + 1] = sqrt(3) / 2 * RESTLEN * i;
+        }
+    }
+
+    int rank = domain.launch();
+
+    double ***forces = new double **[netSize];
+
+    for (int i = 0; i < netSize; i++)
+    {
+        forces[i] = NULL;
+
+        if (!domain.needsRow(i))
+            continue;
+
+        forces[i] = new double *[netSize];
+
+        for (int j = 0; j < netSize; j++)
+            forces[i][j] = new double[6];
+    }
+
+    Network net(pos, delta, spring, forces);
+    net.setRows(domain.iBegin, domain.iEnd);
+    Motors motorarray(spring);
+
+    // The first step is not timed, since it touches all the memory first.
+
+    double started = 0.0;
+    int steps = 0;
+
+    for (int i = 0; ; i++)
+    {
+        double rate = protocol.rate(i % nTimeSteps);
+
+        if (t.tile > 0)
+            net.step(rate, temp, t.tile, motors ? &motorarray : NULL);
+        else
+        {
+            if (motors)
+                net.getNetForces(motorarray);
+            else
+                net.getNetForces();
+
+            domain.reduce(net.calcStress(rate));
+            net.moveNodes(rate, temp);
+        }
+
+        if (i == 0)
+            started = now();
+        else
+            steps++;
+
+        // The first process decides when to stop, and the others see its
+        // decision after the exchange.
+
+        if (rank == 0)
+            *stop = i > 0 && now() - started >= seconds ? 1.0 : 0.0;
+
+        domain.exchange();
+
+        if (*stop != 0.0)
+            break;
+    }
+
+    double elapsed = now() - started;
+
+    if (rank != 0)
+        _exit(0);
+
+    return domain.join(0) == 0 && elapsed > 0
+        ? steps * (double) netSize * netSize / elapsed : 0.0;
+}
+
+// timeCandidate runs runCandidate in a child process and returns its result,
+// or 0 if the configuration failed.
+
+static double timeCandidate(const Tuning &t, double ***spring,
+        const Protocol &protocol, int nTimeSteps, double temp, bool motors,
+        double seconds)
+{
+    double *result = static_cast<double *>(mmap(NULL, sizeof(double),
+            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+
+    if (result == MAP_FAILED)
+        return 0.0;
+
+    *result = 0.0;
+
+    // Flush stdout so the child doesn't repeat buffered output.
+    fflush(stdout);
+
+    pid_t pid = fork();
+
+    if (pid == 0)
+    {
+        try
+        {
+            double rate = runCandidate(t, spring, protocol, nTimeSteps,
+                    temp, motors, seconds);
+
+            *result = rate;
+        }
+        catch (...)
+        {
+        }
+
+        // The child must not run the destructors of the integrator.
+        _exit(0);
+    }
+
+    double rate = 0.0;
+
+    if (pid > 0)
+    {
+        waitpid(pid, NULL, 0);
+        rate = *result;
+    }
+
+    munmap(result, sizeof(double));
+    return rate;
+}
+
+static bool readCache(std::string cacheFile, std::string host, Tuning &t)
+{
+    FILE *in = fopen(cacheFile.c_str(), "r");
+
+    if (in == NULL)
+        return false;
+
+    char name[256];
+    int size, procs, tile;
+    double rate;
+    bool found = false;
+
+    while (fscanf(in, "%255s %d %d %d %lf", name, &size, &procs, &tile, &rate) == 5)
+    {
+        if (host == name && size == netSize)
+        {
+            t.procs = procs;
+            t.tile = tile;
+            t.rate = rate;
+            found = true;
+        }
+    }
+
+    fclose(in);
+    return found;
+}
+
+static void writeCache(std::string cacheFile, std::string host, const Tuning &t)
+{
+    FILE *out = fopen(cacheFile.c_str(), "a");
+
+    if (out == NULL)
+    {
+        printf("Autotune: couldn't write %s.\n", cacheFile.c_str());
+        return;
+    }
+
+    fprintf(out, "%s %d %d %d %.4g\n", host.c_str(), netSize, t.procs, t.tile, t.rate);
+    fclose(out);
+}
+
+Tuning autotune(double ***spring, const Protocol &protocol, int nTimeSteps,
+        double temp, bool motors, double budget, std::string cacheFile)
+{
+    std::string host = hostName();
+
+    // Motors are only supported by a single process, and every strip should
+    // hold at least two rows.
+
+    int maxProcs = motors ? 1 : (int) std::thread::hardware_concurrency();
+
+    if (maxProcs > netSize / 2)
+        maxProcs = netSize / 2;
+    if (maxProcs < 1)
+        maxProcs = 1;
+
+    Tuning best;
+    best.procs = 1;
+    best.tile = 0;
+    best.rate = 0.0;
+
+    if (!cacheFile.empty() && readCache(cacheFile, host, best)
+            && best.procs >= 1 && best.procs <= maxProcs
+            && best.tile >= 0 && (best.tile == 0 || best.procs == 1))
+    {
+        printf("Autotune: ");
+        describe(best);
+        printf(" for %s, N = %d (cached in %s).\n", host.c_str(), netSize,
+                cacheFile.c_str());
+        return best;
+    }
+
+    std::vector<Tuning> candidates;
+
+    for (int procs = 1; procs <= maxProcs; procs *= 2)
+    {
+        Tuning t;
+        t.procs = procs;
+        t.tile = 0;
+        t.rate = 0.0;
+        candidates.push_back(t);
+    }
+
+    for (int tile = 1; tile <= netSize; tile *= 4)
+    {
+        Tuning t;
+        t.procs = 1;
+        t.tile = tile;
+        t.rate = 0.0;
+        candidates.push_back(t);
+    }
+
+    double seconds = budget / candidates.size();
+
+    printf("Autotune: timing %d configurations for %.3g s each.\n",
+            (int) candidates.size(), seconds);
+
+    for (size_t c = 0; c < candidates.size(); c++)
+    {
+        Tuning &t = candidates[c];
+        t.rate = timeCandidate(t, spring, protocol, nTimeSteps, temp,
+                motors, seconds);
+
+        printf("  ");
+        describe(t);
+        printf(": %.4g node-steps/s\n", t.rate);
+
+        if (t.rate > best.rate)
+            best = t;
+    }
+
+    printf("Autotune: using ");
+    describe(best);
+    printf(".\n");
+
+    if (!cacheFile.empty() && best.rate > 0.0)
+        writeCache(cacheFile, host, best);
+
+    return best;
+}
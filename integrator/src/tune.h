@@ -0,0 +1,47 @@
+#ifndef TUNE_H_
+#define TUNE_H_
+
+// tune.h
+// ------
+//
+// tune.h declares the autotuner of the integrator (--autotune). The fastest
+// way to integrate a network depends on its size, its bond probability and
+// the machine: how many processes share the network (see domain.h), and
+// whether the separate force, stress and move kernels or the fused step of
+// Network::step are used, and with how many rows per tile.
+//
+// autotune times every candidate configuration for a few steps on the actual
+// springs of the run, within a fixed budget of seconds, and picks the one
+// with the most node-steps per second. Each candidate runs in a forked copy
+// of the integrator, so the trials leave the state of the run (the positions,
+// affdel and the PRNG) untouched.
+//
+// The choice can be cached in a file, with one line per (host, netSize):
+//
+//   host netSize procs tile node-steps-per-second
+//
+// Later runs with the same host and network size then skip the timing. The
+// last line for a key wins, so the file can simply be appended to.
+
+#include <string>
+#include "protocol.h"
+
+extern int netSize;
+
+struct Tuning {
+
+    int procs;      // Number of processes sharing the network
+    int tile;       // Rows per tile of Network::step, 0 for separate kernels
+    double rate;    // Node-steps per second measured for this configuration
+
+};
+
+// autotune returns the fastest configuration for a network with the given
+// springs, driven by the first nTimeSteps steps of the protocol at the
+// given temperature. It spends about budget seconds timing candidates unless
+// cacheFile (if not empty) holds a choice for this host and network size,
+// and logs its decision to standard output.
+Tuning autotune(double ***spring, const Protocol &protocol, int nTimeSteps,
+        double temp, bool motors, double budget, std::string cacheFile);
+
+#endif /* TUNE_H_ */
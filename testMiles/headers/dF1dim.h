@@ -7,8 +7,6 @@
 #ifndef DF1DIM_H_
 #define DF1DIM_H_
 
-extern int netSize;
-
 template <class T>
 struct Df1dim {
 
@@ -23,8 +21,8 @@ struct Df1dim {
     Df1dim(double *pp, double *xii, T &funcdd) :
         p(pp), xi(xii), funcd(funcdd) {
 
-        xt = new double[2 * netSize * netSize];
-        dft = new double[2 * netSize * netSize];
+        xt = new double[funcd.size()];
+        dft = new double[funcd.size()];
         
     }
     
@@ -37,7 +35,7 @@ struct Df1dim {
         
     double operator() (const double x) {
 
-        for (int j = 0; j < 2 * netSize * netSize; j++)
+        for (int j = 0; j < funcd.size(); j++)
 
             xt[j]=p[j]+x*xi[j];
 
@@ -50,7 +48,7 @@ struct Df1dim {
         double df1 = 0.0;
         funcd.df(xt, dft);
 
-        for (int j = 0; j < 2 * netSize * netSize; j++)
+        for (int j = 0; j < funcd.size(); j++)
 
             df1 += dft[j] * xi[j];
 
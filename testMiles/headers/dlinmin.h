@@ -10,8 +10,6 @@
 #include "dbrent.h"
 #include "dF1dim.h"
 
-extern int netSize;
-
 // Base class for line-minimization algorithms. Provides the line-minimization
 // routine linmin.
 
@@ -38,7 +36,7 @@ struct Dlinemethod {
     double linmin() {
 
         double ax, xx, xmin;
-        n = 2 * netSize * netSize;
+        n = func.size();
         Df1dim<T> Df1dim(p, xi, func);
 
         //Initial guess for brackets.
@@ -10,8 +10,6 @@
 
 #include "dlinmin.h"
 
-extern int netSize;
-
 template <class T>
 struct Frprmn : Dlinemethod<T> {
 
@@ -59,7 +57,7 @@ struct Frprmn : Dlinemethod<T> {
         
         // n is the length of p.
 
-        int n = 2 * netSize * netSize;
+        int n = func.size();
         
         p = pp;
 
@@ -14,6 +14,12 @@
 // ------------------------------------
 //
 // Calculates the gradient of the network's energy.
+//
+// size ()
+// -------
+//
+// Reports the number of coordinates. The minimizer works with any struct
+// that has these three methods, e.g. GraphFuncd of graphfuncd.h.
 
 #ifndef FUNCD_H_
 #define FUNCD_H_
@@ -48,6 +54,11 @@ struct Funcd {
 
     Funcd(double *** ssprstiff) : spr(ssprstiff) {}
 
+    // size is the number of coordinates of the network, the length of the
+    // arrays passed to the minimizer.
+
+    int size() const { return 2 * netSize * netSize; }
+
     // The () operator (function call) is now used to calculate the energy of
     // a network. This operator must contain the energy function for the
     // network.
@@ -0,0 +1,256 @@
+// graphfuncd.h
+// ------------
+//
+// graphfuncd.h provides the energy function and its gradient for a network of
+// arbitrary topology, like funcd.h does for the triangular lattice, so that
+// Frprmn can minimize it.
+//
+// The network (struct Graph) is read from the graph files of the integrator
+// (see integrator/src/graph.h), with one item per line:
+//
+//   box width height [offset]      The periodic box and the shift in x of
+//                                  its image above
+//   node x y                       The next node, numbered from 0
+//   bond a b stiffness restlength [cross]
+//                                  A bond between nodes a and b, which crosses
+//                                  the top of the box cross times
+//
+// The bonds are stored in compressed sparse row form: the bonds of node n
+// are start[n] to start[n + 1] - 1.
+//
+// The strain shifts the image above the box by strain * height in x, in
+// addition to offset.
+
+#ifndef GRAPHFUNCD_H_
+#define GRAPHFUNCD_H_
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <stdio.h>
+#include <math.h>
+
+extern double strain;
+
+struct Graph {
+
+    int nodes, bonds;
+    double width, height, offset;
+    std::vector<double> pos;            // [2 * nodes]
+    std::vector<int> start;             // [nodes + 1]
+    std::vector<int> other;             // [bonds]
+    std::vector<int> crossings;         // [bonds]
+    std::vector<double> stiffness;      // [bonds]
+    std::vector<double> restLength;     // [bonds]
+
+    Graph() : nodes(0), bonds(0), width(0), height(0), offset(0) {}
+
+    // load reads the graph from the file. It returns 0, or prints what is
+    // wrong with the file and returns 1.
+
+    int load(std::string fileName) {
+
+        FILE *in = fopen(fileName.c_str(), "r");
+
+        if (in == NULL) {
+            printf("Couldn't open graph file %s.\n", fileName.c_str());
+            return 1;
+        }
+
+        std::vector<int> a, b, cross;
+        std::vector<double> k, l;
+        char line[1024];
+        int lineNo = 0, ret = 0;
+
+        while (ret == 0 && fgets(line, sizeof(line), in) != NULL) {
+
+            lineNo++;
+
+            char *comment = strchr(line, '#');
+            if (comment != NULL)
+                *comment = '\0';
+
+            char key[16];
+            int used = 0;
+
+            if (sscanf(line, " %15s%n", key, &used) != 1)
+                continue;
+
+            const char *rest = line + used;
+            double x, y, stiff, rlen;
+            int n1, n2, c = 0;
+
+            if (!strcmp(key, "box")) {
+                if (sscanf(rest, "%lf %lf %lf", &width, &height, &offset) < 2
+                        || width <= 0 || height <= 0)
+                    ret = 1;
+            } else if (!strcmp(key, "node")) {
+                if (sscanf(rest, "%lf %lf", &x, &y) != 2)
+                    ret = 1;
+                pos.push_back(x);
+                pos.push_back(y);
+            } else if (!strcmp(key, "bond")) {
+                if (sscanf(rest, "%d %d %lf %lf %d", &n1, &n2, &stiff, &rlen, &c) < 4
+                        || rlen <= 0 || c < -1 || c > 1)
+                    ret = 1;
+                a.push_back(n1);
+                b.push_back(n2);
+                k.push_back(stiff);
+                l.push_back(rlen);
+                cross.push_back(c);
+            } else
+                ret = 1;
+
+            if (ret != 0)
+                printf("%s:%d: bad line: %s", fileName.c_str(), lineNo, line);
+        }
+
+        fclose(in);
+
+        if (ret != 0)
+            return ret;
+
+        if (width <= 0) {
+            printf("%s: the box is missing.\n", fileName.c_str());
+            return 1;
+        }
+
+        nodes = pos.size() / 2;
+        bonds = a.size();
+
+        // Sort the bonds into rows by counting.
+
+        start.assign(nodes + 1, 0);
+
+        for (int i = 0; i < bonds; i++) {
+
+            if (a[i] < 0 || a[i] >= nodes || b[i] < 0 || b[i] >= nodes || a[i] == b[i]) {
+                printf("%s: bond %d joins nodes %d and %d of %d.\n",
+                        fileName.c_str(), i, a[i], b[i], nodes);
+                return 1;
+            }
+
+            start[a[i] + 1]++;
+        }
+
+        for (int n = 0; n < nodes; n++)
+            start[n + 1] += start[n];
+
+        other.resize(bonds);
+        crossings.resize(bonds);
+        stiffness.resize(bonds);
+        restLength.resize(bonds);
+
+        std::vector<int> next(start.begin(), start.end() - 1);
+
+        for (int i = 0; i < bonds; i++) {
+            int j = next[a[i]]++;
+            other[j] = b[i];
+            crossings[j] = cross[i];
+            stiffness[j] = k[i];
+            restLength[j] = l[i];
+        }
+
+        return 0;
+    }
+
+};
+
+struct GraphFuncd {
+
+    const Graph &graph;
+
+    GraphFuncd(const Graph &ggraph) : graph(ggraph) {}
+
+    // size is the number of coordinates of the network.
+
+    int size() const { return 2 * graph.nodes; }
+
+    // The energy of the network with positions x, as in Funcd.
+
+    double operator() (double *x) {
+
+        double funcvalue = 0.0;
+        double dx, dy;
+
+        for (int n = 0; n < graph.nodes; n++) {
+            for (int b = graph.start[n]; b < graph.start[n + 1]; b++) {
+
+                double delta = bond(x, n, b, dx, dy) - graph.restLength[b];
+                funcvalue += 0.5 * graph.stiffness[b] / graph.restLength[b]
+                    * delta * delta;
+
+            }
+        }
+
+        return funcvalue;
+    }
+
+    // df sets dx to the gradient of the energy. Every bond adds its force to
+    // both of its nodes.
+
+    void df(double *x, double *dx) {
+
+        double bx, by;
+
+        for (int k = 0; k < size(); k++)
+            dx[k] = 0.0;
+
+        for (int n = 0; n < graph.nodes; n++) {
+            for (int b = graph.start[n]; b < graph.start[n + 1]; b++) {
+
+                int m = graph.other[b];
+                double dist = bond(x, n, b, bx, by);
+                double temp = graph.stiffness[b] * (dist - graph.restLength[b])
+                    / graph.restLength[b] / dist;
+
+                dx[2 * n] -= temp * bx;
+                dx[2 * n + 1] -= temp * by;
+                dx[2 * m] += temp * bx;
+                dx[2 * m + 1] += temp * by;
+
+            }
+        }
+
+    }
+
+    // calcStress returns the shear stress of the network with positions x.
+
+    double calcStress(double *x) {
+
+        double stress = 0.0;
+        double bx, by;
+
+        for (int n = 0; n < graph.nodes; n++) {
+            for (int b = graph.start[n]; b < graph.start[n + 1]; b++) {
+
+                double dist = bond(x, n, b, bx, by);
+                stress += graph.stiffness[b] * (dist - graph.restLength[b])
+                    / graph.restLength[b] * bx / dist * by;
+
+            }
+        }
+
+        return stress / (graph.width * graph.height);
+    }
+
+    private:
+
+    // bond sets (bx, by) to the vector along bond b of node n, from the
+    // nearest periodic image of its far end, and returns its length.
+
+    inline double bond(const double *x, int n, int b, double &bx, double &by) const {
+
+        int m = graph.other[b];
+        int cross = graph.crossings[b];
+
+        bx = x[2 * m] - x[2 * n] + cross * (graph.offset + strain * graph.height);
+        bx -= graph.width * floor(bx / graph.width + 0.5);
+        by = x[2 * m + 1] - x[2 * n + 1] + cross * graph.height;
+
+        return sqrt(bx * bx + by * by);
+    }
+
+};
+
+#endif /*GRAPHFUNCD_H_*/
@@ -37,11 +37,8 @@ inline void SWAP(double a, double b) {
 
 }
 
-inline double abs(double a) {
-
-    return a >= 0 ? a : -a;
-
-}
+// abs(double) comes from <stdlib.h>, which declares the C++ overloads of
+// std::abs in the global namespace.
 
 inline double MAX(double a, double b) {
 
@@ -61,7 +58,8 @@ inline double SIGN(double a, double b) {
 inline void usageExit() {
     printf("usage:");
     printf("\n   program [-str <strain>] [-size <network size>] [-p <bond ");
-    printf("probability>] [-y <young's modulus for spring>]\n");
+    printf("probability>] [-y <young's modulus for spring>] [-seed <PRNG seed>]\n");
+    printf("   program [-str <strain>] -graph <graph file>\n");
     exit(EXIT_FAILURE);
 }
 
@@ -19,8 +19,9 @@ int main (int argc, char *argv[]) {
         fclose(file);
         for (double strain = 0.01; strain < 0.095; strain += 0.01) {
             
-            char command[32];
-            sprintf(command, "./program -str %3.2f -p %4.3f", strain, pBond);
+            char command[128];
+            snprintf(command, sizeof(command), "./program -str %3.2f -p %4.3f",
+                    strain, pBond);
             system(command);
 
         }
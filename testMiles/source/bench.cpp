@@ -0,0 +1,307 @@
+/* bench.cpp
+ * ---------
+ *
+ * bench.cpp times the kernels of the static minimizer: the energy function
+ * Funcd::operator(), its gradient Funcd::df, and a complete minimization
+ * with Frprmn::minimize. For every combination of the requested network
+ * sizes and bond probabilities, one line per kernel is printed with the time
+ * per node per call and the memory traffic implied by the arrays it touches.
+ * For the minimization, the time and traffic are given per node and per
+ * conjugate gradient iteration.
+ *
+ * Built with make PERFCOUNTERS=1 minbench, every kernel line is followed by
+ * the hardware counters of the same calls (see
+ * integrator/src/perfcounters.h): cycles, instructions, IPC, L1 and LLC
+ * misses and branch misses per node, and whether the kernel looks compute-,
+ * latency- or bandwidth-bound.
+ *
+ * Usage: bench [-size <n,n,...>] [-p <p,p,...>] [-str <strain>]
+ *              [-time <seconds>]
+ */
+
+#include <string>
+#include <vector>
+#include <ctime>
+#include <stdlib.h>
+#include <math.h>
+#include "funcd.h"
+#include "frprmn.h"
+#include "utils.h"
+
+#ifdef PERFCOUNTERS
+#include "perfcounters.h"
+#endif
+
+using namespace std;
+
+const double RESTLEN = 1;
+
+int netSize;
+double strain;
+
+// Bytes moved per node by the energy function (positions and springs) and
+// by the gradient (positions, springs and the gradient itself). The springs
+// are counted with one pointer of the double*** table per node.
+
+const double energyBytes = 16 + 32;
+const double gradientBytes = 16 + 32 + 16;
+
+// Bytes moved per node by the vector updates of one iteration of frprmn and
+// linmin: p, xi, g and h are each read and written about once.
+
+const double iterationBytes = 4 * 16 * 2;
+
+// CountingFuncd counts how often the minimizer evaluates the energy and the
+// gradient, so that the traffic of a minimization can be estimated.
+
+struct CountingFuncd : Funcd {
+
+    long evals, grads;
+
+    CountingFuncd(double ***ssprstiff) : Funcd(ssprstiff), evals(0), grads(0) {}
+
+    double operator() (double *x) {
+
+        evals++;
+        return Funcd::operator()(x);
+
+    }
+
+    void df(double *x, double *dx) {
+
+        grads++;
+        Funcd::df(x, dx);
+
+    }
+
+};
+
+static double now() {
+
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+
+}
+
+// parseList splits a comma-separated list of numbers.
+
+static vector<double> parseList(const char *arg) {
+
+    vector<double> values;
+    string str = arg;
+    size_t start = 0;
+
+    while (start <= str.size()) {
+
+        size_t end = str.find(',', start);
+        if (end == string::npos)
+            end = str.size();
+
+        values.push_back(atof(str.substr(start, end - start).c_str()));
+        start = end + 1;
+
+    }
+
+    return values;
+
+}
+
+static void printLine(const char *kernel, double pBond, double perCall,
+        double bytes) {
+
+    double nodes = (double) netSize * netSize;
+
+    printf("%-18s %7d %6.3g %14.3f %12.0f %10.3f\n", kernel, netSize, pBond,
+            1e9 * perCall / nodes, bytes, bytes * nodes / perCall * 1e-9);
+
+}
+
+#ifdef PERFCOUNTERS
+
+PerfCounters counters;
+
+// printCounters prints the counts between begin and end of calls calls.
+
+static void printCounters(const double *begin, const double *end, double calls) {
+
+    double c[PerfCounters::num_counters];
+    double n = calls * netSize * (double) netSize;
+
+    for (int k = 0; k < PerfCounters::num_counters; k++)
+        c[k] = end[k] - begin[k];
+
+    if (!(c[PerfCounters::cycles] == c[PerfCounters::cycles])) {
+        printf("%18s (no hardware counters)\n", "");
+        return;
+    }
+
+    printf("%18s cycles %.2f instr %.2f IPC %.2f L1miss %.4f LLCmiss %.4f"
+            " brmiss %.4f per node: %s\n", "", c[PerfCounters::cycles] / n,
+            c[PerfCounters::instructions] / n,
+            c[PerfCounters::instructions] / c[PerfCounters::cycles],
+            c[PerfCounters::l1_misses] / n, c[PerfCounters::llc_misses] / n,
+            c[PerfCounters::branch_misses] / n,
+            PerfCounters::bound(c[PerfCounters::cycles],
+                c[PerfCounters::instructions], c[PerfCounters::llc_misses]));
+
+}
+
+#define COUNTERS_READ(values) counters.read(values)
+#define COUNTERS_PRINT(begin, end, calls) printCounters(begin, end, calls)
+
+#else
+
+#define COUNTERS_READ(values)
+#define COUNTERS_PRINT(begin, end, calls)
+
+#endif
+
+int main (int argc, char *argv[]) {
+
+    vector<double> sizes, probs;
+    double minTime = 0.2;
+    strain = 0.01;
+
+    for (int i = 1; i < argc; i += 2) {
+        string str = argv[i];
+        if (i + 1 >= argc) {
+            printf("%s needs a value.\n", argv[i]);
+            return 1;
+        } else if (!str.compare("-size")) {
+            sizes = parseList(argv[i + 1]);
+        } else if (!str.compare("-p")) {
+            probs = parseList(argv[i + 1]);
+        } else if (!str.compare("-str")) {
+            strain = atof(argv[i + 1]);
+        } else if (!str.compare("-time")) {
+            minTime = atof(argv[i + 1]);
+        } else {
+            printf("%s is an illegal argument.\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (sizes.empty()) {
+        sizes.push_back(16);
+        sizes.push_back(64);
+        sizes.push_back(256);
+    }
+
+    if (probs.empty())
+        probs.push_back(0.8);
+
+    double checksum = 0.0;
+#ifdef PERFCOUNTERS
+    double countsBegin[PerfCounters::num_counters];
+    double countsEnd[PerfCounters::num_counters];
+#endif
+
+    printf("%-18s %7s %6s %14s %12s %10s\n", "kernel", "netSize", "pBond",
+            "ns/node-step", "bytes/node", "GB/s");
+
+    for (size_t a = 0; a < sizes.size(); a++) {
+        for (size_t b = 0; b < probs.size(); b++) {
+
+            netSize = (int) sizes[a];
+            srand(1);
+
+            double network_height = netSize * sqrt(3.0) / 2.0;
+            double strain_distance = strain * network_height;
+
+            double *position = new double[2 * netSize * netSize];
+            double *gradient = new double[2 * netSize * netSize];
+            double ***sprstiff = new double **[netSize];
+
+            for (int i = 0; i < netSize; i++) {
+
+                sprstiff[i] = new double *[netSize];
+
+                for (int j = 0; j < netSize; j++) {
+
+                    position[(i * netSize + j) * 2] = RESTLEN * (i / 2.0 + j)
+                        + strain_distance * i / (double) netSize;
+                    position[(i * netSize + j) * 2 + 1] = sqrt(3) / 2 * RESTLEN * i;
+
+                    sprstiff[i][j] = stiffVecGen(probs[b], 1.0, 3);
+                }
+            }
+
+            CountingFuncd funcd(sprstiff);
+
+            // Energy and gradient: repeat until minTime has passed.
+
+            for (int kernel = 0; kernel < 2; kernel++) {
+
+                long reps = 1;
+                double elapsed;
+
+                while (true) {
+
+                    COUNTERS_READ(countsBegin);
+                    double start = now();
+
+                    for (long r = 0; r < reps; r++) {
+                        if (kernel == 0) {
+                            checksum += funcd(position);
+                        } else {
+                            funcd.df(position, gradient);
+                            checksum += gradient[0];
+                        }
+                    }
+
+                    elapsed = now() - start;
+                    COUNTERS_READ(countsEnd);
+
+                    if (elapsed >= minTime || reps >= (1L << 24))
+                        break;
+
+                    reps *= 2;
+                }
+
+                if (kernel == 0)
+                    printLine("Funcd::operator()", probs[b], elapsed / reps,
+                            energyBytes);
+                else
+                    printLine("Funcd::df", probs[b], elapsed / reps,
+                            gradientBytes);
+
+                COUNTERS_PRINT(countsBegin, countsEnd, reps);
+            }
+
+            // A full minimization from the affinely strained network.
+
+            funcd.evals = funcd.grads = 0;
+
+            Frprmn<CountingFuncd> frprmn(funcd);
+            COUNTERS_READ(countsBegin);
+            double start = now();
+            frprmn.minimize(position);
+            double elapsed = now() - start;
+            COUNTERS_READ(countsEnd);
+
+            int iterations = frprmn.iter + 1;
+            double bytes = (funcd.evals * energyBytes
+                    + funcd.grads * gradientBytes) / iterations + iterationBytes;
+
+            checksum += frprmn.fret;
+            printLine("Frprmn::minimize", probs[b], elapsed / iterations, bytes);
+            COUNTERS_PRINT(countsBegin, countsEnd, iterations);
+
+            for (int i = 0; i < netSize; i++) {
+                for (int j = 0; j < netSize; j++)
+                    delete[] sprstiff[i][j];
+                delete[] sprstiff[i];
+            }
+
+            delete[] sprstiff;
+            delete[] position;
+            delete[] gradient;
+        }
+    }
+
+    // Printing the checksum keeps the kernels from being optimized away.
+    fprintf(stderr, "checksum %g\n", checksum);
+
+    return 0;
+}
@@ -3,7 +3,10 @@
  *
  * program.cpp is the client file in simulating the spring networks.
  * Usage: program -str <strain> -size <network size> -p <bond probability> -y \
- * <young's modulus for springs>
+ * <young's modulus for springs> -seed <PRNG seed>
+ *
+ * With -graph <file>, the network of arbitrary topology in the file (see
+ * graphfuncd.h) is minimized instead of a triangular lattice.
  *
  * Author: Miles Yucht
  * Date: Mon June 27 2012
@@ -16,6 +19,7 @@
 #include <stdlib.h>
 #include <math.h>
 #include "funcd.h"
+#include "graphfuncd.h"
 #include "frprmn.h"
 #include "utils.h"
 #include "network.h"
@@ -28,6 +32,48 @@ const double RESTLEN = 1;
 int netSize;
 double strain;
 
+// minimizeGraph minimizes the energy of the graph in the file at the strain,
+// and appends its moduli to compare_data.txt like the lattice does.
+
+static int minimizeGraph(string fileName) {
+
+    Graph graph;
+
+    if (graph.load(fileName))
+        return 1;
+
+    printf("strain is %3.2f, graph of %d nodes and %d bonds\n", strain,
+            graph.nodes, graph.bonds);
+
+    // Start from the affine deformation of the graph.
+
+    double *position = new double[2 * graph.nodes];
+
+    for (int n = 0; n < graph.nodes; n++) {
+        position[2 * n] = graph.pos[2 * n] + strain * graph.pos[2 * n + 1];
+        position[2 * n + 1] = graph.pos[2 * n + 1];
+    }
+
+    GraphFuncd func(graph);
+    Frprmn<GraphFuncd> frprmn(func);
+    double *newArray = frprmn.minimize(position);
+    double newEnergy = func(newArray);
+    double stress = func.calcStress(newArray);
+
+    FILE * compareData = fopen("compare_data.txt", "a");
+
+    fprintf(compareData, "Stress                 = %f\n", stress);
+    fprintf(compareData, "G (stress calculation) = %f\n", stress / strain);
+    fprintf(compareData, "G (energy calculation) = %f\n", 2 * newEnergy /
+            (graph.width * graph.height * strain * strain));
+
+    fclose(compareData);
+
+    delete[] position;
+
+    return 0;
+}
+
 int main (int argc, char *argv[]) {
 
     // Default values.
@@ -36,8 +82,8 @@ int main (int argc, char *argv[]) {
     double youngMod = 1.0;
     netSize = 20;
     strain = 0.0;
-
-    srand( time(NULL) );
+    unsigned int seed = (unsigned int) time(NULL);
+    string graphFile;
 
     //Otherwise, parse the command line parameters.
 
@@ -51,6 +97,10 @@ int main (int argc, char *argv[]) {
             pBond = atof(argv[i + 1]);
         } else if (!str.compare("-y")) {
             youngMod = atof(argv[i + 1]);
+        } else if (!str.compare("-seed")) {
+            seed = (unsigned int) atoi(argv[i + 1]);
+        } else if (!str.compare("-graph")) {
+            graphFile = argv[i + 1];
         } else if (!str.compare("--help") || !str.compare("help")) {
             usageExit();
         } else {
@@ -59,6 +109,11 @@ int main (int argc, char *argv[]) {
         }
     }
 
+    srand( seed );
+
+    if (!graphFile.empty())
+        return minimizeGraph(graphFile);
+
     printf("strain is %3.2f, pBond is %4.3f\n", strain, pBond);
     // Now that those are parsed, we can start to generate our network.
 